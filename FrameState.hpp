@@ -0,0 +1,45 @@
+#ifndef FRAME_STATE_HPP
+#define FRAME_STATE_HPP
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "PointLight.hpp"
+
+// Способ освещения освещенных объектов сцены
+enum class RenderPath
+{
+    Forward,    // Освещение при отрисовке объекта (вариант CLUSTERED)
+    Deferred    // Запись G-буфера и отдельный полноэкранный проход освещения
+};
+
+/**
+ * @brief FrameState - Неизменяемый снимок сцены, который поток обновления передает потоку рендеринга.
+ * Содержит только готовые к отрисовке данные, поэтому рендерер не обращается ни к камере, ни к вводу.
+ */
+struct FrameState
+{
+    glm::mat4 view{1.0f};           // Матрица вида
+    glm::mat4 projection{1.0f};     // Матрица проекции
+
+    glm::mat4 starModel{1.0f};      // Модельная матрица звезды (источника света)
+    glm::mat4 planetModel{1.0f};    // Модельная матрица планеты
+    glm::mat4 skyModel{1.0f};       // Модельная матрица небесной сферы
+    std::vector<glm::mat4> asteroidModels;  // Модельные матрицы астероидов (рисуются экземплярами меша планеты)
+
+    glm::vec3 lightPosition{0.0f};  // Текущая позиция источника света для освещения планеты
+
+    PointLight pointLights[MAX_POINT_LIGHTS];   // Точечные источники света (кластерное освещение)
+    unsigned int pointLightCount = 0;
+
+    int framebufferWidth = 0;       // Размеры кадрового буфера окна
+    int framebufferHeight = 0;
+
+    bool showGpuOverlay = false;    // Показывать полосы времени GPU-проходов поверх кадра
+    RenderPath renderPath = RenderPath::Forward;
+
+    unsigned long long frameIndex = 0; // Порядковый номер снимка
+};
+
+#endif // FRAME_STATE_HPP
@@ -1,93 +1,185 @@
 #include "Mesh.hpp"
+#include "cpuprofiler.h"
 
-Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures)
+#include <cstring>
+
+Mesh::Mesh(unsigned int vertexStreams, size_t vertexCount, size_t indexCount,
+           const VertexWriter& writeVertices, const IndexWriter& writeIndices,
+           const Texture* textures, size_t textureCount, bool keepGeometry)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->vertexStreams = vertexStreams;
+    this->indexCount = static_cast<GLsizei>(indexCount);
+    this->material = Material(textures, textureCount);
+
+    // Материал с картой нормалей требует варианта шейдера HAS_NORMAL_MAP
+    if (material.has(TEXTURE_SLOT_NORMAL))
+        features |= HAS_NORMAL_MAP;
 
     // Теперь, когда у нас есть все необходимые данные, устанавливаем вершинные буферы и указатели атрибутов
-    setupMesh();
+    if (!keepGeometry)
+    {
+        setupMesh(vertexCount, writeVertices, writeIndices);
+        return;
+    }
+
+    // Копия на CPU нужна вызывающему: пишем в нее, а буферы заполняем уже из копии
+    vertices.resize(vertexCount * vertexStride(vertexStreams));
+    indices.resize(indexCount);
+    writeVertices(vertices.data());
+    writeIndices(indices.data());
+    setupMesh(vertexCount,
+              [this](float* out) { std::memcpy(out, vertices.data(), vertices.size() * sizeof(float)); },
+              [this](unsigned int* out) { std::memcpy(out, indices.data(), indices.size() * sizeof(unsigned int)); });
 }
 
-void Mesh::Draw(const Shader& shader)
+Mesh::~Mesh()
 {
-    // Связываем соответствующие текстуры
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int heightNr = 1;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    // У перемещенного меша буферов нет, их учет перешел вместе с ними
+    if (VBO != 0)
     {
-        glActiveTexture(GL_TEXTURE0 + i); // перед связыванием активируем нужный текстурный юнит
-
-        // Получаем номер текстуры (номер N в diffuse_textureN)
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++); // конвертируем unsigned int в строку
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++); // конвертируем unsigned int в строку
-        else if (name == "texture_height")
-            number = std::to_string(heightNr++); // конвертируем unsigned int в строку
-
-        // Теперь устанавливаем сэмплер на нужный текстурный юнит
-        glUniform1i(glGetUniformLocation(shader.ID(), (name + number).c_str()), static_cast<GLint>(i));
-        // и связываем текстуру
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        GpuMemory::release(vertexResource);
+        GpuMemory::release(indexResource);
     }
+}
+
+void Mesh::Draw(const Shader& shader)
+{
+    PROFILE_ZONE("Mesh::Draw");
+
+    // Сэмплеры программы уже указывают на юниты материала (см. Shader::finalize)
+    static_cast<void>(shader);
+    makeResident();
+    material.bind();
 
     // Отрисовываем меш
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
     glBindVertexArray(0);
 
     // Считается хорошей практикой возвращать значения переменных к их первоначальным значениям
     glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::setupMesh()
+void Mesh::DrawInstanced(const Shader& shader, unsigned int instanceBuffer, GLsizei count)
+{
+    PROFILE_ZONE("Mesh::DrawInstanced");
+
+    static_cast<void>(shader);
+    makeResident();
+    material.bind();
+
+    glBindVertexArray(VAO);
+    if (instanceVBO != instanceBuffer)
+    {
+        // mat4 занимает четыре подряд идущих атрибута-столбца, каждый продвигается раз в экземпляр
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(5 + column);
+            glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(sizeof(glm::vec4) * column));
+            glVertexAttribDivisor(5 + column, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        instanceVBO = instanceBuffer;
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, count);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+unsigned int Mesh::materialFeatures() const
+{
+    return features;
+}
+
+void Mesh::makeResident()
+{
+    // Оба буфера отмечаются использованными, даже если первый оказался вытеснен
+    bool verticesResident = GpuMemory::use(vertexResource);
+    bool indicesResident = GpuMemory::use(indexResource);
+    if (verticesResident && indicesResident)
+        return;
+
+    // GL_COPY_WRITE_BUFFER не входит в состояние VAO, поэтому привязки атрибутов и индексов не меняются
+    if (!verticesResident)
+    {
+        size_t bytes = vertices.size() * sizeof(float);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        fillBuffer(GL_COPY_WRITE_BUFFER, bytes, [this, bytes](void* memory) { std::memcpy(memory, vertices.data(), bytes); });
+        GpuMemory::resize(vertexResource, bytes);
+    }
+    if (!indicesResident)
+    {
+        size_t bytes = indices.size() * sizeof(unsigned int);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        fillBuffer(GL_COPY_WRITE_BUFFER, bytes, [this, bytes](void* memory) { std::memcpy(memory, indices.data(), bytes); });
+        GpuMemory::resize(indexResource, bytes);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void Mesh::setupMesh(size_t vertexCount, const VertexWriter& writeVertices, const IndexWriter& writeIndices)
 {
     // Создаем буферные объекты/массивы
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    VAO = VertexArrayHandle::create();
+    VBO = BufferHandle::create();
+    EBO = BufferHandle::create();
 
     glBindVertexArray(VAO);
 
     // Загружаем данные в вершинный буфер
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    // Самое замечательное в структурах то, что расположение в памяти их внутренних переменных является последовательным.
-    // Смысл данного трюка в том, что мы можем просто передать указатель на структуру, и она прекрасно преобразуется в массив данных с элементами типа glm::vec3 (или glm::vec2), который затем будет преобразован в массив данных float, ну а в конце – в байтовый массив
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    // Вершины упакованы плоским массивом float'ов, включенные потоки идут подряд в порядке их location
+    size_t vertexBytes = vertexCount * vertexStride(vertexStreams) * sizeof(float);
+    fillBuffer(GL_ARRAY_BUFFER, vertexBytes,
+               [&writeVertices](void* memory) { writeVertices(static_cast<float*>(memory)); });
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // Устанавливаем указатели вершинных атрибутов
-
-    // Координаты вершин
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-
-    // Нормали вершин
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+    size_t indexBytes = static_cast<size_t>(indexCount) * sizeof(unsigned int);
+    fillBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBytes,
+               [&writeIndices](void* memory) { writeIndices(static_cast<unsigned int*>(memory)); });
+
+    // Вытеснять можно только буферы, которые есть чем заполнить заново
+    bool evictable = !vertices.empty();
+    vertexResource = GpuMemory::trackBuffer(VBO, GPU_MEMORY_VERTICES, vertexBytes, evictable);
+    indexResource = GpuMemory::trackBuffer(EBO, GPU_MEMORY_INDICES, indexBytes, evictable);
+
+    // Устанавливаем указатели вершинных атрибутов. Отсутствующие потоки остаются выключенными:
+    // их не читает ни один вариант шейдера, которым рисуется меш
+    GLsizei stride = static_cast<GLsizei>(vertexStride(vertexStreams) * sizeof(float));
+    size_t offset = 0;
+    for (GLuint location = 0; location < VERTEX_STREAM_COUNT; location++)
+    {
+        if (!(vertexStreams & (1u << location)))
+            continue;
+        GLint components = static_cast<GLint>(vertexStreamComponents(location));
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, components, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offset));
+        offset += components * sizeof(float);
+    }
 
-    // Текстурные координаты вершин
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, texCoords)));
+    glBindVertexArray(0);
+}
 
-    // Касательный вектор вершины
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, tangent)));
+void Mesh::fillBuffer(GLenum target, size_t bytes, const std::function<void(void*)>& write)
+{
+    glBufferData(target, static_cast<GLsizeiptr>(bytes), nullptr, GL_STATIC_DRAW);
+    if (bytes == 0)
+        return;
 
-    // Вектор бинормали вершины
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, bitangent)));
+    // Прежнее содержимое буфера не нужно: драйвер может отдать свежую память без синхронизации
+    void* memory = glMapBufferRange(target, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (memory != nullptr)
+    {
+        write(memory);
+        // GL_FALSE - содержимое потеряно (например, при смене видеорежима), заполняем заново через копию
+        if (glUnmapBuffer(target) == GL_TRUE)
+            return;
+    }
 
-    glBindVertexArray(0);
+    std::vector<unsigned char> staging(bytes);
+    write(staging.data());
+    glBufferSubData(target, 0, static_cast<GLsizeiptr>(bytes), staging.data());
 }
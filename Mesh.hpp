@@ -9,7 +9,12 @@
 #include "shader.h" // shader.h идентичен файлу shader_s.h
 #include "Vertex.hpp"
 #include "Texture.hpp"
+#include "material.h"
+#include "ShaderFeatures.hpp"
+#include "glresource.h"
+#include "gpumemory.h"
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -17,27 +22,73 @@
 
 class Mesh {
 public:
-    // Конструктор
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures);
+    // Заполняет память размером ровно под все вершины (индексы) меша
+    using VertexWriter = std::function<void(float* vertices)>;
+    using IndexWriter = std::function<void(unsigned int* indices)>;
+
+    /**
+     * @brief Mesh - Конструктор. Буферы сразу создаются нужного размера, а вершины и индексы пишутся прямо в их
+     * отображенную память, без промежуточных массивов (если драйвер не может отобразить буфер - через одну
+     * временную копию).
+     * @param vertexStreams - Потоки вершины (см. VertexStream), упакованные подряд в порядке location.
+     * @param writeVertices - Записывает vertexCount упакованных вершин.
+     * @param writeIndices - Записывает indexCount индексов.
+     * @param textures - textureCount текстур материала; массив нужен только на время конструктора.
+     * @param keepGeometry - Оставить копию вершин и индексов в памяти процесса (cpuVertices/cpuIndices).
+     * Только такой меш GpuMemory может вытеснить из видеопамяти: перед следующей отрисовкой он загрузится из копии.
+     */
+    Mesh(unsigned int vertexStreams, size_t vertexCount, size_t indexCount,
+         const VertexWriter& writeVertices, const IndexWriter& writeIndices,
+         const Texture* textures, size_t textureCount, bool keepGeometry = false);
+
+    // Меши модели лежат в одном массиве и перемещаются при его сортировке
+    Mesh(Mesh&& other) = default;
+    Mesh& operator=(Mesh&& other) = default;
+
+    // Буферы и VAO уходят в GLDeletionQueue
+    ~Mesh();
 
     // Рендеринг меша
     void Draw(const Shader& shader);
 
+    // Рендеринг count экземпляров меша (вариант шейдера INSTANCED). instanceBuffer содержит по одной mat4 на экземпляр
+    void DrawInstanced(const Shader& shader, unsigned int instanceBuffer, GLsizei count);
+
+    // Флаги ShaderFeature, которые требует материал меша
+    unsigned int materialFeatures() const;
+
+    // Копии геометрии в памяти процесса (пусты, если при создании не просили keepGeometry)
+    const std::vector<float>& cpuVertices() const { return vertices; }
+    const std::vector<unsigned int>& cpuIndices() const { return indices; }
+
 private:
     Mesh() = default;
-    Mesh(const Mesh& anoter) = default;
+    Mesh(const Mesh& anoter) = delete;
 
 
     // Инициализируем все буферные объекты/массивы
-    void setupMesh();
+    void setupMesh(size_t vertexCount, const VertexWriter& writeVertices, const IndexWriter& writeIndices);
+
+    // Отмечаем буферы использованными в кадре; вытесненные загружаем заново из копии на CPU
+    void makeResident();
+
+    // Выделяем буфер target размером bytes и заполняем его функцией write
+    static void fillBuffer(GLenum target, size_t bytes, const std::function<void(void*)>& write);
 
 private:
     // Данные меша
-    std::vector<Vertex> vertices;
+    std::vector<float> vertices;
+    unsigned int vertexStreams = VERTEX_STREAM_ALL;
     std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
-    unsigned int VAO;
+    GLsizei indexCount = 0;
+    Material material;
+    VertexArrayHandle VAO;
     // Данные для рендеринга
-    unsigned int VBO, EBO;
+    BufferHandle VBO, EBO;
+    GpuMemory::ResourceId vertexResource = GpuMemory::NO_RESOURCE;
+    GpuMemory::ResourceId indexResource = GpuMemory::NO_RESOURCE;
+    // Буфер экземпляров, привязанный к атрибутам 5..8 VAO (0 - еще не привязан)
+    unsigned int instanceVBO = 0;
+    unsigned int features = SHADER_FEATURE_NONE;
 };
 #endif
@@ -6,11 +6,22 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 INCLUDEPATH += $$PWD/libraries/include/
+
+# Профилирование CPU-зон (cpuprofiler.h): qmake CONFIG+=profile_zones
+profile_zones {
+    DEFINES += ONION_PROFILE
+}
 win32 {
     LIBS += -L$$PWD/libraries/bin/glfw/x32/ -lglfw3dll
     LIBS += -L$$PWD/libraries/bin/Assimp/x32/ -llibassimp.dll
 }
 
+# Безоконный режим замера (--headless) через EGL, в том числе на Mesa llvmpipe
+unix:!macx {
+    DEFINES += ONION_HEADLESS
+    LIBS += -lglfw -lassimp -lEGL -ldl -lpthread
+}
+
 #win64 {
 #    LIBS += -L$$PWD/libraries/bin/glfw/x64/ -lglfw3dll
 #    LIBS += -L$$PWD/libraries/bin/Assimp/x64/ -llibassimp.dll
@@ -18,17 +29,76 @@ win32 {
 
 SOURCES += \
     Mesh.cpp \
+    assetpack.cpp \
+    barneshut.cpp \
+    benchmark.cpp \
     camera.cpp \
+    camerapath.cpp \
+    clusteredlighting.cpp \
+    cpuprofiler.cpp \
+    gbuffer.cpp \
     glad.c \
+    glextensions.cpp \
+    glresource.cpp \
+    gpumemory.cpp \
+    gpuprofiler.cpp \
+    headless.cpp \
+    importprofile.cpp \
     main.cpp \
+    mappedfile.cpp \
+    material.cpp \
     model.cpp \
-    shader.cpp
+    modelimport.cpp \
+    objbenchmark.cpp \
+    objloader.cpp \
+    orbitalsystem.cpp \
+    orbitbenchmark.cpp \
+    packiosystem.cpp \
+    renderer.cpp \
+    sceneloader.cpp \
+    shader.cpp \
+    shadervariants.cpp \
+    threadpool.cpp \
+    transformbenchmark.cpp \
+    transformsystem.cpp
 
 HEADERS += \
+    FrameState.hpp \
     Mesh.hpp \
+    PointLight.hpp \
+    ShaderFeatures.hpp \
+    Simd.hpp \
     Texture.hpp \
+    TripleBuffer.hpp \
     Vertex.hpp \
+    assetpack.h \
+    barneshut.h \
+    benchmark.h \
     camera.h \
+    camerapath.h \
+    clusteredlighting.h \
+    cpuprofiler.h \
+    gbuffer.h \
+    glextensions.h \
+    glresource.h \
+    gpumemory.h \
+    gpuprofiler.h \
+    headless.h \
+    importprofile.h \
+    mappedfile.h \
+    material.h \
     model.h \
-    shader.h
+    modelimport.h \
+    objbenchmark.h \
+    objloader.h \
+    orbitalsystem.h \
+    orbitbenchmark.h \
+    packiosystem.h \
+    renderer.h \
+    sceneloader.h \
+    shader.h \
+    shadervariants.h \
+    threadpool.h \
+    transformbenchmark.h \
+    transformsystem.h
 
@@ -0,0 +1,18 @@
+#ifndef POINT_LIGHT_HPP
+#define POINT_LIGHT_HPP
+
+#include <glm/glm.hpp>
+
+// Максимальное число точечных источников света в кадре
+const unsigned int MAX_POINT_LIGHTS = 256;
+
+// Точечный источник света с ограниченным радиусом действия (станции, огни кораблей, дальние звезды)
+struct PointLight
+{
+    glm::vec3 position{0.0f};   // Позиция в мировых координатах
+    float radius = 1.0f;        // За пределами радиуса освещенность равна нулю
+    glm::vec3 color{1.0f};      // Цвет
+    float intensity = 1.0f;     // Множитель яркости
+};
+
+#endif // POINT_LIGHT_HPP
@@ -0,0 +1,18 @@
+#ifndef SHADER_FEATURES_HPP
+#define SHADER_FEATURES_HPP
+
+// Флаги возможностей шейдера. Каждый флаг превращается в одноименный #define варианта программы,
+// а их комбинация - в ключ кэша вариантов (см. ShaderVariants)
+enum ShaderFeature : unsigned int
+{
+    SHADER_FEATURE_NONE = 0,
+    HAS_NORMAL_MAP      = 1u << 0,  // Материал содержит карту нормалей (texture_normal1)
+    UNLIT               = 1u << 1,  // Без освещения: только диффузная текстура
+    INSTANCED           = 1u << 2,  // Модельная матрица берется из атрибута экземпляра (location 5..8)
+    CLUSTERED           = 1u << 3,  // Точечные источники света из кластерной сетки (ClusteredLighting)
+    GBUFFER             = 1u << 4,  // Запись альбедо, нормали и ID материала в G-буфер вместо освещения (GBuffer)
+
+    SHADER_FEATURE_COUNT = 5
+};
+
+#endif // SHADER_FEATURES_HPP
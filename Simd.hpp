@@ -0,0 +1,11 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// SSE есть на всех x86-64 и на x86 с /arch:SSE и выше. На остальных платформах (ARM и т.п.) горячие циклы
+// собираются в скалярном варианте с тем же результатом
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define ONION_SIMD_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#endif // SIMD_HPP
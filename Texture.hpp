@@ -1,13 +1,73 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
-#include <string>
+// Назначение текстуры в материале. В шейдере ей соответствуют сэмплеры texture_<имя слота>N, N = 1..MAX_TEXTURES_PER_SLOT
+enum TextureSlot : unsigned int
+{
+    TEXTURE_SLOT_DIFFUSE = 0,   // texture_diffuseN
+    TEXTURE_SLOT_SPECULAR,      // texture_specularN
+    TEXTURE_SLOT_NORMAL,        // texture_normalN
+    TEXTURE_SLOT_HEIGHT,        // texture_heightN
+
+    TEXTURE_SLOT_COUNT
+};
+
+// Сколько текстур одного слота может использовать материал
+const unsigned int MAX_TEXTURES_PER_SLOT = 4;
+
+// Префикс имени сэмплера для слота
+inline const char* textureSlotName(TextureSlot slot)
+{
+    static const char* const NAMES[TEXTURE_SLOT_COUNT] = {
+        "texture_diffuse",
+        "texture_specular",
+        "texture_normal",
+        "texture_height"
+    };
+    return NAMES[slot];
+}
+
+// Постоянный текстурный юнит сэмплера texture_<слот>N (index = N - 1). Юниты одинаковы во всех программах,
+// поэтому сэмплеры устанавливаются один раз при сборке программы, а материал только привязывает текстуры
+inline unsigned int textureUnit(TextureSlot slot, unsigned int index)
+{
+    return static_cast<unsigned int>(slot) * MAX_TEXTURES_PER_SLOT + index;
+}
+
+// Юниты служебных сэмплеров, не относящихся к материалам. Идут сразу после юнитов материалов
+// и так же назначаются программам один раз при сборке (по имени сэмплера)
+enum ReservedTextureUnit : unsigned int
+{
+    TEXTURE_UNIT_CLUSTER_GRID = TEXTURE_SLOT_COUNT * MAX_TEXTURES_PER_SLOT,    // clusterGrid
+    TEXTURE_UNIT_CLUSTER_LIGHT_INDICES,                                         // clusterLightIndices
+    TEXTURE_UNIT_CLUSTER_LIGHTS,                                                // clusterLights
+    TEXTURE_UNIT_GBUFFER_ALBEDO,                                                // gAlbedo
+    TEXTURE_UNIT_GBUFFER_NORMAL,                                                // gNormal
+    TEXTURE_UNIT_GBUFFER_DEPTH,                                                 // gDepth
+
+    TEXTURE_UNIT_RESERVED_END
+};
+
+// Имя сэмплера для служебного юнита
+inline const char* reservedSamplerName(ReservedTextureUnit unit)
+{
+    static const char* const NAMES[TEXTURE_UNIT_RESERVED_END - TEXTURE_UNIT_CLUSTER_GRID] = {
+        "clusterGrid",
+        "clusterLightIndices",
+        "clusterLights",
+        "gAlbedo",
+        "gNormal",
+        "gDepth"
+    };
+    return NAMES[unit - TEXTURE_UNIT_CLUSTER_GRID];
+}
 
+// Текстура в материале меша. Путь к файлу хранит только кеш загруженных текстур модели
 struct Texture
 {
     unsigned int id;
-    std::string type;
-    std::string path;
+    TextureSlot slot;
+    unsigned int resource;  // GpuMemory::ResourceId
 };
 
 #endif // TEXTURE_HPP
@@ -0,0 +1,75 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief TripleBuffer - Lock-free тройной буфер для передачи данных от одного производителя одному потребителю.
+ * Производитель всегда пишет в свой буфер и публикует его, потребитель всегда читает самый свежий
+ * опубликованный буфер. Ни одна из сторон не ждет другую: промежуточный (средний) буфер
+ * обменивается атомарной операцией exchange.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * @brief writeBuffer - Буфер, принадлежащий производителю. Вызывается только из потока производителя.
+     */
+    T& writeBuffer()
+    {
+        return m_buffers[m_write].value;
+    }
+
+    /**
+     * @brief publish - Публикуем заполненный буфер производителя и забираем себе средний буфер.
+     */
+    void publish()
+    {
+        uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_write | DIRTY_BIT), std::memory_order_acq_rel);
+        m_write = previous & INDEX_MASK;
+    }
+
+    /**
+     * @brief update - Забираем самый свежий опубликованный буфер. Вызывается только из потока потребителя.
+     * @return - true, если с момента прошлого вызова был опубликован новый буфер.
+     */
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & DIRTY_BIT) == 0)
+            return false;
+        uint8_t previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+        m_read = previous & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     * @brief readBuffer - Буфер, принадлежащий потребителю. Остается неизменным до следующего update().
+     */
+    const T& readBuffer() const
+    {
+        return m_buffers[m_read].value;
+    }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t DIRTY_BIT = 0x4;
+
+    // Каждый буфер на своей кэш-линии, чтобы потоки не мешали друг другу (false sharing)
+    struct alignas(64) Slot
+    {
+        T value{};
+    };
+
+    Slot                    m_buffers[3];
+    std::atomic<uint8_t>    m_middle{2};    // индекс среднего буфера + флаг "опубликован новый кадр"
+    alignas(64) uint8_t     m_write = 0;    // индекс буфера производителя
+    alignas(64) uint8_t     m_read = 1;     // индекс буфера потребителя
+};
+
+#endif // TRIPLE_BUFFER_HPP
@@ -1,16 +1,37 @@
 #ifndef VERTEX_HPP
 #define VERTEX_HPP
 
-#include <glm/glm.hpp>
-
-struct Vertex
+// Потоки вершинных атрибутов. Номер бита совпадает с location атрибута в шейдере.
+// Вершина в буфере - плотно упакованные float'ы включенных потоков в порядке номеров битов,
+// поэтому меш хранит и загружает на GPU только то, что читает его шейдер (см. ImportProfile)
+enum VertexStream : unsigned int
 {
-    glm::vec3 position;     // Позиция
-    glm::vec3 normal;       // Нормаль
-    glm::vec2 texCoords;    // Текстурные координаты
-    glm::vec3 tangent;      // Касательный вектор
-    glm::vec3 bitangent;    // Вектор бинормали (вектор, перпендикулярный касательному вектору и вектору нормали)
+    VERTEX_POSITION     = 1u << 0,  // Позиция (vec3)
+    VERTEX_NORMAL       = 1u << 1,  // Нормаль (vec3)
+    VERTEX_TEXCOORDS    = 1u << 2,  // Текстурные координаты (vec2)
+    VERTEX_TANGENT      = 1u << 3,  // Касательный вектор (vec3)
+    VERTEX_BITANGENT    = 1u << 4,  // Вектор бинормали (вектор, перпендикулярный касательному вектору и вектору нормали)
 
+    VERTEX_STREAM_ALL   = (1u << 5) - 1,
+    VERTEX_STREAM_COUNT = 5
 };
 
+// Количество float-компонент в потоке с указанным location
+inline unsigned int vertexStreamComponents(unsigned int location)
+{
+    return location == 2 ? 2 : 3;
+}
+
+// Размер вершины в float'ах для набора потоков
+inline unsigned int vertexStride(unsigned int streams)
+{
+    unsigned int stride = 0;
+    for (unsigned int location = 0; location < VERTEX_STREAM_COUNT; location++)
+    {
+        if (streams & (1u << location))
+            stride += vertexStreamComponents(location);
+    }
+    return stride;
+}
+
 #endif // VERTEX_HPP
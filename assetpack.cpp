@@ -0,0 +1,379 @@
+#include "assetpack.h"
+#include "cpuprofiler.h"
+#include "mappedfile.h"
+
+#include "STB/stb_image.h"
+
+// Сжатие записей при сборке пакета - zlib из stb_image_write, распаковка - из stb_image
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "STB/stb_image_write.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char PACK_MAGIC[8] = { 'O', 'N', 'I', 'O', 'N', 'P', 'A', 'K' };
+
+    enum Compression : std::uint32_t
+    {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_ZLIB = 1
+    };
+
+    // Уровень сжатия stbi_zlib_compress (как у PNG по умолчанию)
+    const int ZLIB_QUALITY = 8;
+
+    std::unique_ptr<AssetPack> s_mounted;
+
+    size_t alignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Путь без "." и "x/..", с разделителем '/'
+    std::string normalizePath(const std::string& path)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        std::string unified = path;
+        std::replace(unified.begin(), unified.end(), '\\', '/');
+        while (begin <= unified.size())
+        {
+            size_t end = unified.find('/', begin);
+            if (end == std::string::npos)
+                end = unified.size();
+            std::string part = unified.substr(begin, end - begin);
+            if (part == "..")
+            {
+                if (!parts.empty() && parts.back() != "..")
+                    parts.pop_back();
+                else
+                    parts.push_back(part);
+            }
+            else if (!part.empty() && part != ".")
+            {
+                parts.push_back(part);
+            }
+            begin = end + 1;
+        }
+
+        std::string result = (!unified.empty() && unified[0] == '/') ? "/" : "";
+        for (size_t i = 0; i < parts.size(); i++)
+        {
+            if (i > 0)
+                result += '/';
+            result += parts[i];
+        }
+        return result;
+    }
+}
+
+
+
+// Заголовок в начале файла пакета
+struct AssetPack::Header
+{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   entryCount;
+    std::uint64_t   entriesOffset;  // Таблица Entry, отсортированная по имени
+    std::uint64_t   namesOffset;    // Имена записей подряд, без нулей в конце
+    std::uint64_t   namesSize;
+};
+
+
+
+struct AssetPack::Entry
+{
+    std::uint64_t   offset;         // Начало данных, кратно ENTRY_ALIGNMENT
+    std::uint64_t   storedSize;     // Размер данных в пакете
+    std::uint64_t   size;           // Размер файла
+    std::uint32_t   nameOffset;
+    std::uint32_t   nameLength;
+    std::uint32_t   compression;    // Compression
+    std::uint32_t   reserved;
+};
+
+
+
+AssetPack::AssetPack() = default;
+AssetPack::~AssetPack() = default;
+
+
+
+bool AssetPack::open(const std::string& packPath, const std::string& mountPoint)
+{
+    PROFILE_ZONE("AssetPack::open");
+
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->open(packPath))
+    {
+        std::cout << "ERROR::ASSET_PACK::CAN'T OPEN FILE " << packPath << std::endl;
+        return false;
+    }
+
+    const size_t fileSize = file->size();
+    Header header;
+    if (fileSize < sizeof(Header))
+    {
+        std::cout << "ERROR::ASSET_PACK::INVALID HEADER " << packPath << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(Header));
+    if (std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != VERSION)
+    {
+        std::cout << "ERROR::ASSET_PACK::INVALID HEADER " << packPath << std::endl;
+        return false;
+    }
+    if (header.entriesOffset % alignof(Entry) != 0
+        || header.entriesOffset > fileSize || header.entryCount > (fileSize - header.entriesOffset) / sizeof(Entry)
+        || header.namesOffset > fileSize || header.namesSize > fileSize - header.namesOffset)
+    {
+        std::cout << "ERROR::ASSET_PACK::INVALID INDEX " << packPath << std::endl;
+        return false;
+    }
+
+    const Entry* entries = reinterpret_cast<const Entry*>(file->data() + header.entriesOffset);
+    for (size_t i = 0; i < header.entryCount; i++)
+    {
+        const Entry& entry = entries[i];
+        if (entry.offset > fileSize || entry.storedSize > fileSize - entry.offset
+            || static_cast<std::uint64_t>(entry.nameOffset) + entry.nameLength > header.namesSize
+            || (entry.compression == COMPRESSION_NONE && entry.storedSize != entry.size)
+            || entry.compression > COMPRESSION_ZLIB)
+        {
+            std::cout << "ERROR::ASSET_PACK::INVALID INDEX " << packPath << std::endl;
+            return false;
+        }
+    }
+
+    m_file = std::move(file);
+    m_entries = entries;
+    m_entryCount = header.entryCount;
+    m_names = reinterpret_cast<const char*>(m_file->data() + header.namesOffset);
+    m_namesSize = static_cast<size_t>(header.namesSize);
+    m_mountPoint = normalizePath(mountPoint);
+    return true;
+}
+
+
+
+bool AssetPack::contains(const std::string& path) const
+{
+    return find(path) != nullptr;
+}
+
+
+
+bool AssetPack::read(const std::string& path, Data& out) const
+{
+    const Entry* entry = find(path);
+    if (entry == nullptr)
+        return false;
+
+    const unsigned char* stored = m_file->data() + entry->offset;
+    out.storage.clear();
+    if (entry->compression == COMPRESSION_NONE)
+    {
+        out.data = stored;
+        out.size = static_cast<size_t>(entry->size);
+        return true;
+    }
+
+    PROFILE_ZONE("AssetPack::inflate");
+    out.storage.resize(static_cast<size_t>(entry->size));
+    int inflated = stbi_zlib_decode_buffer(reinterpret_cast<char*>(out.storage.data()), static_cast<int>(entry->size),
+                                           reinterpret_cast<const char*>(stored), static_cast<int>(entry->storedSize));
+    if (inflated < 0 || static_cast<std::uint64_t>(inflated) != entry->size)
+    {
+        std::cout << "ERROR::ASSET_PACK::CAN'T INFLATE " << path << std::endl;
+        out.storage.clear();
+        return false;
+    }
+    out.data = out.storage.data();
+    out.size = out.storage.size();
+    return true;
+}
+
+
+
+size_t AssetPack::size() const
+{
+    return m_entryCount;
+}
+
+
+
+const AssetPack::Entry* AssetPack::find(const std::string& path) const
+{
+    if (m_entries == nullptr)
+        return nullptr;
+    std::string name = relativePath(path);
+    if (name.empty())
+        return nullptr;
+
+    // Таблица отсортирована побайтово, как std::string::compare
+    auto compare = [this](const Entry& entry, const std::string& key) {
+        size_t common = std::min<size_t>(entry.nameLength, key.size());
+        int result = std::memcmp(m_names + entry.nameOffset, key.data(), common);
+        if (result != 0)
+            return result < 0;
+        return entry.nameLength < key.size();
+    };
+    const Entry* end = m_entries + m_entryCount;
+    const Entry* found = std::lower_bound(m_entries, end, name, compare);
+    if (found == end || entryName(*found) != name)
+        return nullptr;
+    return found;
+}
+
+
+
+std::string AssetPack::entryName(const Entry& entry) const
+{
+    return std::string(m_names + entry.nameOffset, entry.nameLength);
+}
+
+
+
+std::string AssetPack::relativePath(const std::string& path) const
+{
+    std::string normalized = normalizePath(path);
+    if (m_mountPoint.empty())
+        return normalized;
+    if (normalized.size() <= m_mountPoint.size() || normalized.compare(0, m_mountPoint.size(), m_mountPoint) != 0
+        || normalized[m_mountPoint.size()] != '/')
+        return std::string();
+    return normalized.substr(m_mountPoint.size() + 1);
+}
+
+
+
+bool AssetPack::build(const std::string& root, const std::vector<std::string>& directories, const std::string& packPath)
+{
+    PROFILE_ZONE("AssetPack::build");
+    namespace fs = std::filesystem;
+
+    // Пути записей - относительно root, в порядке сортировки таблицы
+    std::vector<std::string> names;
+    std::error_code error;
+    for (const std::string& directory : directories)
+    {
+        for (fs::recursive_directory_iterator it(fs::u8path(root) / fs::u8path(directory), error), end; !error && it != end; it.increment(error))
+        {
+            if (it->is_regular_file())
+                names.push_back(it->path().lexically_relative(fs::u8path(root)).generic_u8string());
+        }
+        if (error)
+        {
+            std::cout << "ERROR::ASSET_PACK::CAN'T READ DIRECTORY " << root << '/' << directory << std::endl;
+            return false;
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    std::ofstream pack(fs::u8path(packPath), std::ios::binary | std::ios::trunc);
+    if (!pack)
+    {
+        std::cout << "ERROR::ASSET_PACK::CAN'T WRITE FILE " << packPath << std::endl;
+        return false;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<std::uint32_t>(names.size());
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+    std::vector<Entry> entries(names.size());
+    std::string nameTable;
+    size_t offset = sizeof(Header);
+    size_t totalSize = 0, storedSize = 0;
+    const char padding[ENTRY_ALIGNMENT] = {};
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        std::ifstream file(fs::u8path(root) / fs::u8path(names[i]), std::ios::binary);
+        std::vector<unsigned char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.eof() && file.fail())
+        {
+            std::cout << "ERROR::ASSET_PACK::CAN'T READ FILE " << names[i] << std::endl;
+            return false;
+        }
+
+        Entry& entry = entries[i];
+        entry = {};
+        entry.size = contents.size();
+        entry.nameOffset = static_cast<std::uint32_t>(nameTable.size());
+        entry.nameLength = static_cast<std::uint32_t>(names[i].size());
+        nameTable += names[i];
+
+        // Сжатая запись должна стоить распаковки: иначе она читается прямо из отображения
+        const unsigned char* data = contents.data();
+        size_t dataSize = contents.size();
+        unsigned char* compressed = nullptr;
+        int compressedSize = 0;
+        if (!contents.empty() && contents.size() <= static_cast<size_t>(INT_MAX))
+            compressed = stbi_zlib_compress(contents.data(), static_cast<int>(contents.size()), &compressedSize, ZLIB_QUALITY);
+        if (compressed != nullptr && static_cast<size_t>(compressedSize) <= contents.size() - contents.size() / 8)
+        {
+            entry.compression = COMPRESSION_ZLIB;
+            data = compressed;
+            dataSize = static_cast<size_t>(compressedSize);
+        }
+
+        size_t aligned = alignUp(offset, ENTRY_ALIGNMENT);
+        pack.write(padding, static_cast<std::streamsize>(aligned - offset));
+        pack.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(dataSize));
+        STBIW_FREE(compressed);
+
+        entry.offset = aligned;
+        entry.storedSize = dataSize;
+        offset = aligned + dataSize;
+        totalSize += contents.size();
+        storedSize += dataSize;
+    }
+
+    size_t entriesOffset = alignUp(offset, alignof(Entry));
+    pack.write(padding, static_cast<std::streamsize>(entriesOffset - offset));
+    pack.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    pack.write(nameTable.data(), static_cast<std::streamsize>(nameTable.size()));
+
+    header.entriesOffset = entriesOffset;
+    header.namesOffset = entriesOffset + entries.size() * sizeof(Entry);
+    header.namesSize = nameTable.size();
+    pack.seekp(0);
+    pack.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    if (!pack)
+    {
+        std::cout << "ERROR::ASSET_PACK::CAN'T WRITE FILE " << packPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Asset pack " << packPath << ": " << names.size() << " files, "
+              << totalSize / 1024 << " KB -> " << storedSize / 1024 << " KB" << std::endl;
+    return true;
+}
+
+
+
+bool AssetPack::mount(const std::string& packPath, const std::string& mountPoint)
+{
+    std::unique_ptr<AssetPack> pack(new AssetPack());
+    if (!pack->open(packPath, mountPoint))
+        return false;
+    s_mounted = std::move(pack);
+    return true;
+}
+
+
+
+const AssetPack* AssetPack::mounted()
+{
+    return s_mounted.get();
+}
@@ -0,0 +1,90 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * @brief AssetPack - Все ресурсы (модели, материалы, текстуры, шейдеры) в одном файле, отображенном в память.
+ * Файл: заголовок, данные записей (каждая выровнена на ENTRY_ALIGNMENT и, если это выгодно, сжата zlib),
+ * таблица записей, отсортированная по пути, и имена. Поиск - двоичный по таблице, а несжатая запись
+ * читается прямо из отображения, без копий и без открытия файлов.
+ * Пути записей - относительно корня пакета, разделитель '/'. Пакет после открытия только читается,
+ * поэтому его можно использовать из любого потока.
+ */
+class AssetPack
+{
+public:
+    static const std::uint32_t VERSION = 1;
+    static const size_t ENTRY_ALIGNMENT = 64;
+
+    // Содержимое записи: указатель в отображение пакета или в storage, если запись была сжата
+    struct Data
+    {
+        const unsigned char*        data = nullptr;
+        size_t                      size = 0;
+        std::vector<unsigned char>  storage;
+    };
+
+    AssetPack();
+    ~AssetPack();
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    /**
+     * @brief open - Отображаем файл пакета в память и проверяем заголовок и таблицу записей.
+     * @param mountPoint - Каталог, который пакет заменяет: путь mountPoint/x ищется как запись x.
+     */
+    bool open(const std::string& packPath, const std::string& mountPoint);
+
+    // Есть ли в пакете файл path (путь в том виде, в каком его открывает программа)
+    bool contains(const std::string& path) const;
+
+    /**
+     * @brief read - Получаем содержимое файла path. Несжатая запись не копируется.
+     * @return false, если файла нет в пакете или его не удалось распаковать.
+     */
+    bool read(const std::string& path, Data& out) const;
+
+    size_t size() const;
+
+    /**
+     * @brief build - Собираем пакет из всех файлов каталогов directories внутри root.
+     * Запись сжимается, если это уменьшает ее хотя бы на восьмую часть (текст - да, jpg - обычно нет).
+     */
+    static bool build(const std::string& root, const std::vector<std::string>& directories, const std::string& packPath);
+
+    /**
+     * @brief mount - Открываем пакет, через который дальше читают модели, текстуры и шейдеры.
+     * Вызывается при запуске, до загрузки ресурсов.
+     */
+    static bool mount(const std::string& packPath, const std::string& mountPoint);
+
+    // Подключенный пакет (nullptr - ресурсы читаются из отдельных файлов)
+    static const AssetPack* mounted();
+
+private:
+    struct Header;
+    struct Entry;
+
+    const Entry* find(const std::string& path) const;
+    std::string entryName(const Entry& entry) const;
+
+    // Путь без "./", "x/..", '\\' и без точки монтирования; пустая строка - путь вне пакета
+    std::string relativePath(const std::string& path) const;
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    const Entry*                m_entries = nullptr;
+    size_t                      m_entryCount = 0;
+    const char*                 m_names = nullptr;
+    size_t                      m_namesSize = 0;
+    std::string                 m_mountPoint;
+};
+
+#endif // ASSET_PACK_H
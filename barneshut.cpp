@@ -0,0 +1,182 @@
+#include "barneshut.h"
+#include "cpuprofiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void BarnesHut::build(const float* x, const float* y, const float* z, const float* mass, size_t count)
+{
+    PROFILE_ZONE("BarnesHut::build");
+
+    m_x = x;
+    m_y = y;
+    m_z = z;
+    m_mass = mass;
+
+    m_nodes.clear();
+    if (count == 0)
+        return;
+    // Дерево из N тел занимает порядка N узлов; резервируем с запасом, чтобы не копировать при росте
+    m_nodes.reserve(count * 2 + 8);
+
+    glm::vec3 low(x[0], y[0], z[0]);
+    glm::vec3 high = low;
+    for (size_t i = 1; i < count; i++)
+    {
+        glm::vec3 p(x[i], y[i], z[i]);
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+
+    Node root;
+    root.center = (low + high) * 0.5f;
+    // Небольшой запас, чтобы тела на границе не попадали в потомков по ошибке округления
+    root.halfSize = std::max(std::max(high.x - low.x, high.y - low.y), std::max(high.z - low.z, 1e-6f)) * 0.5f * 1.001f;
+    m_nodes.push_back(root);
+
+    for (size_t i = 0; i < count; i++)
+        insert(static_cast<int>(i));
+
+    for (Node& node : m_nodes)
+        node.massCenter = node.mass > 0.0f ? node.massCenter / node.mass : node.center;
+
+    m_x = m_y = m_z = m_mass = nullptr;
+}
+
+
+
+glm::vec3 BarnesHut::acceleration(const glm::vec3& position, float selfMass, float theta, float softening2) const
+{
+    glm::vec3 result(0.0f);
+    if (m_nodes.empty())
+        return result;
+
+    const float theta2 = theta * theta;
+    int stack[8 * MAX_DEPTH + 8];
+    int top = 0;
+    stack[top++] = 0;
+    // Узел, в который тело попало при вставке на текущей глубине: обход в глубину держит в стеке не больше одного такого
+    int path = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const Node& node = m_nodes[static_cast<size_t>(index)];
+        if (node.mass <= 0.0f)
+            continue;
+
+        float mass = node.mass;
+        glm::vec3 massCenter = node.massCenter;
+        if (index == path)
+        {
+            if (node.firstChild >= 0)
+            {
+                // Узел с самим телом не заменяем точечной массой: спускаемся по пути тела дальше
+                path = node.firstChild + octant(node, position);
+                for (int child = 0; child < 8; child++)
+                    stack[top++] = node.firstChild + child;
+                continue;
+            }
+            // Лист тела: одиночное тело - это оно само, из слитых вычитаем его вклад
+            if (node.body != MERGED)
+                continue;
+            mass -= selfMass;
+            if (mass <= 0.0f)
+                continue;
+            massCenter = (node.massCenter * node.mass - position * selfMass) / mass;
+        }
+
+        glm::vec3 delta = massCenter - position;
+        float distance2 = glm::dot(delta, delta) + softening2;
+        float size = node.halfSize * 2.0f;
+        if (node.firstChild < 0 || size * size < theta2 * distance2)
+        {
+            result += delta * (mass / (distance2 * std::sqrt(distance2)));
+            continue;
+        }
+        for (int child = 0; child < 8; child++)
+            stack[top++] = node.firstChild + child;
+    }
+    return result;
+}
+
+
+
+glm::vec3 BarnesHut::position(int body) const
+{
+    return glm::vec3(m_x[body], m_y[body], m_z[body]);
+}
+
+
+
+int BarnesHut::octant(const Node& node, const glm::vec3& position) const
+{
+    return (position.x >= node.center.x ? 1 : 0) | (position.y >= node.center.y ? 2 : 0) | (position.z >= node.center.z ? 4 : 0);
+}
+
+
+
+void BarnesHut::insert(int body)
+{
+    const glm::vec3 p = position(body);
+    const float mass = m_mass[body];
+
+    int index = 0;
+    for (int depth = 0; ; depth++)
+    {
+        // Ссылку на узел берем заново на каждом уровне: split() может перераспределить m_nodes
+        Node& node = m_nodes[static_cast<size_t>(index)];
+        node.mass += mass;
+        node.massCenter += p * mass;
+
+        if (node.firstChild >= 0)
+        {
+            index = node.firstChild + octant(node, p);
+            continue;
+        }
+        if (node.body == EMPTY)
+        {
+            node.body = body;
+            return;
+        }
+        if (depth >= MAX_DEPTH)
+        {
+            node.body = MERGED;
+            return;
+        }
+
+        // Лист уже занят: делим его, прежнее тело уходит в потомка, новое продолжает спуск
+        split(index);
+        const Node& parent = m_nodes[static_cast<size_t>(index)];
+        index = parent.firstChild + octant(parent, p);
+    }
+}
+
+
+
+void BarnesHut::split(int index)
+{
+    int firstChild = static_cast<int>(m_nodes.size());
+    Node parent = m_nodes[static_cast<size_t>(index)];
+    float quarter = parent.halfSize * 0.5f;
+    for (int child = 0; child < 8; child++)
+    {
+        Node node;
+        node.halfSize = quarter;
+        node.center = parent.center + glm::vec3((child & 1) ? quarter : -quarter,
+                                                (child & 2) ? quarter : -quarter,
+                                                (child & 4) ? quarter : -quarter);
+        m_nodes.push_back(node);
+    }
+
+    // Прежнее тело листа уходит в своего потомка (MERGED на глубине меньше MAX_DEPTH не бывает)
+    int previous = parent.body;
+    glm::vec3 p = position(previous);
+    Node& child = m_nodes[static_cast<size_t>(firstChild + octant(parent, p))];
+    child.body = previous;
+    child.mass = m_mass[previous];
+    child.massCenter = p * m_mass[previous];
+
+    Node& node = m_nodes[static_cast<size_t>(index)];
+    node.firstChild = firstChild;
+    node.body = EMPTY;
+}
@@ -0,0 +1,63 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/**
+ * @brief BarnesHut - Октодерево для приближенного расчета гравитации N тел за O(N log N): далекий узел,
+ * видимый под углом меньше theta, заменяется точечной массой в своем центре масс.
+ * build() однопоточный, acceleration() только читает дерево и вызывается из любого числа потоков.
+ */
+class BarnesHut
+{
+public:
+    // Тела ближе, чем на этой глубине, не разделяются и действуют на других суммарной массой
+    static const int MAX_DEPTH = 24;
+
+    /**
+     * @brief build - Строим дерево по положениям и массам (гравитационным параметрам) count тел.
+     */
+    void build(const float* x, const float* y, const float* z, const float* mass, size_t count);
+
+    /**
+     * @brief acceleration - Ускорение, которое все остальные тела сообщают телу дерева в точке position.
+     * Узлы на пути этого тела от корня всегда раскрываются, а из листа, где оно слито с другими, его масса вычитается,
+     * поэтому тело не притягивает само себя.
+     * @param position - Положение тела, переданное в build.
+     * @param selfMass - Масса (гравитационный параметр) тела, переданная в build.
+     * @param softening2 - Квадрат длины сглаживания: ограничивает ускорение при сближении тел.
+     */
+    glm::vec3 acceleration(const glm::vec3& position, float selfMass, float theta, float softening2) const;
+
+private:
+    static const int EMPTY = -1;
+    static const int MERGED = -2;
+
+    struct Node
+    {
+        glm::vec3   center{0.0f};       // Центр куба
+        float       halfSize = 0.0f;
+        glm::vec3   massCenter{0.0f};   // До завершения build - сумма положений, взвешенных массой
+        float       mass = 0.0f;
+        int         firstChild = -1;    // Восемь потомков подряд; -1 - лист
+        int         body = EMPTY;       // Единственное тело листа, EMPTY или MERGED (несколько тел на MAX_DEPTH)
+    };
+
+    glm::vec3 position(int body) const;
+    int octant(const Node& node, const glm::vec3& position) const;
+    void insert(int body);
+    void split(int node);
+
+private:
+    std::vector<Node>   m_nodes;
+
+    // Входные массивы текущего build()
+    const float*        m_x = nullptr;
+    const float*        m_y = nullptr;
+    const float*        m_z = nullptr;
+    const float*        m_mass = nullptr;
+};
+
+#endif // BARNES_HUT_H
@@ -0,0 +1,20 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+double Benchmark::measure(const std::function<void()>& pass, int passes)
+{
+    pass();
+    std::vector<double> samples;
+    samples.reserve(static_cast<size_t>(passes));
+    for (int i = 0; i < passes; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
@@ -0,0 +1,17 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+
+// Общие средства микробенчмарков (--bench-*)
+namespace Benchmark
+{
+    /**
+     * @brief measure - Медиана времени прохода в миллисекундах. Первый проход прогревает кэши (данных и файлов)
+     * и не учитывается.
+     * @param passes - Количество учитываемых проходов.
+     */
+    double measure(const std::function<void()>& pass, int passes);
+}
+
+#endif // BENCHMARK_H
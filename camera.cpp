@@ -1,6 +1,8 @@
 #include "camera.h"
 
-Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+    aspectRatio(ASPECT_RATIO), nearPlane(NEAR_PLANE), farPlane(FAR_PLANE), pendingXOffset(0.0f), pendingYOffset(0.0f),
+    viewMatrix(1.0f), projectionMatrix(1.0f), viewProjectionMatrix(1.0f), viewDirty(true), projectionDirty(true)
 {
     Position = position;
     WorldUp = up;
@@ -9,7 +11,9 @@ Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch) : Front
     updateCameraVectors();
 }
 
-Camera::Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+Camera::Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+    aspectRatio(ASPECT_RATIO), nearPlane(NEAR_PLANE), farPlane(FAR_PLANE), pendingXOffset(0.0f), pendingYOffset(0.0f),
+    viewMatrix(1.0f), projectionMatrix(1.0f), viewProjectionMatrix(1.0f), viewDirty(true), projectionDirty(true)
 {
     Position = glm::vec3(posX, posY, posZ);
     WorldUp = glm::vec3(upX, upY, upZ);
@@ -18,14 +22,53 @@ Camera::Camera(float posX, float posY, float posZ, float upX, float upY, float u
     updateCameraVectors();
 }
 
-glm::mat4 Camera::GetViewMatrix()
+const glm::mat4& Camera::GetViewMatrix() const
 {
-    return glm::lookAt(Position, Position + Front, Up);
+    updateMatrices();
+    return viewMatrix;
+}
+
+const glm::mat4& Camera::GetProjectionMatrix() const
+{
+    updateMatrices();
+    return projectionMatrix;
+}
+
+const glm::mat4& Camera::GetViewProjectionMatrix() const
+{
+    updateMatrices();
+    return viewProjectionMatrix;
+}
+
+const glm::vec4* Camera::GetFrustumPlanes() const
+{
+    updateMatrices();
+    return frustumPlanes;
+}
+
+void Camera::SetViewportSize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    float aspect = static_cast<float>(width) / static_cast<float>(height);
+    if (aspect != aspectRatio)
+    {
+        aspectRatio = aspect;
+        projectionDirty = true;
+    }
+}
+
+void Camera::SetClipPlanes(float nearDistance, float farDistance)
+{
+    nearPlane = nearDistance;
+    farPlane = farDistance;
+    projectionDirty = true;
 }
 
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
     float velocity = MovementSpeed * deltaTime;
+    viewDirty = true;
     switch (direction) {
         case FORWARD:
         {
@@ -63,13 +106,21 @@ void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
     }
 }
 
-void Camera::ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch)
+void Camera::ProcessMouseMovement(float xoffset, float yoffset)
+{
+    pendingXOffset += xoffset;
+    pendingYOffset += yoffset;
+}
+
+void Camera::ApplyMouseMovement(GLboolean constrainPitch)
 {
-    xoffset *= MouseSensitivity;
-    yoffset *= MouseSensitivity;
+    if (pendingXOffset == 0.0f && pendingYOffset == 0.0f)
+        return;
 
-    Yaw   += xoffset;
-    Pitch += yoffset;
+    Yaw   += pendingXOffset * MouseSensitivity;
+    Pitch += pendingYOffset * MouseSensitivity;
+    pendingXOffset = 0.0f;
+    pendingYOffset = 0.0f;
 
     // Убеждаемся, что когда тангаж выходит за пределы обзора, экран не переворачивается
     if (constrainPitch)
@@ -92,6 +143,31 @@ void Camera::ProcessMouseScroll(float yoffset)
         Zoom = 1.0f;
     if (Zoom >= 45.0f)
         Zoom = 45.0f;
+    projectionDirty = true;
+}
+
+void Camera::SetPose(const glm::vec3& position, float yaw, float pitch, float zoom)
+{
+    SetPosition(position);
+    pendingXOffset = 0.0f;
+    pendingYOffset = 0.0f;
+    if (zoom != Zoom)
+    {
+        Zoom = zoom;
+        projectionDirty = true;
+    }
+    if (yaw != Yaw || pitch != Pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+}
+
+void Camera::SetPosition(const glm::vec3& position)
+{
+    Position = position;
+    viewDirty = true;
 }
 
 void Camera::updateCameraVectors()
@@ -106,4 +182,33 @@ void Camera::updateCameraVectors()
     // Также пересчитываем вектор-вправо и вектор-вверх
     Right = glm::normalize(glm::cross(Front, WorldUp)); // нормализуем векторы, потому что их длина стремится к 0 тем больше, чем больше вы смотрите вверх или вниз, что приводит к более медленному движению
     Up = glm::normalize(glm::cross(Right, Front));
+    viewDirty = true;
+}
+
+void Camera::updateMatrices() const
+{
+    if (!viewDirty && !projectionDirty)
+        return;
+
+    if (viewDirty)
+        viewMatrix = glm::lookAt(Position, Position + Front, Up);
+    if (projectionDirty)
+        projectionMatrix = glm::perspective(glm::radians(Zoom), aspectRatio, nearPlane, farPlane);
+    viewDirty = false;
+    projectionDirty = false;
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+    // Плоскости пирамиды - суммы и разности строк матрицы вида-проекции (метод Gribb-Hartmann)
+    const glm::mat4& m = viewProjectionMatrix;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    frustumPlanes[FRUSTUM_LEFT]   = row[3] + row[0];
+    frustumPlanes[FRUSTUM_RIGHT]  = row[3] - row[0];
+    frustumPlanes[FRUSTUM_BOTTOM] = row[3] + row[1];
+    frustumPlanes[FRUSTUM_TOP]    = row[3] - row[1];
+    frustumPlanes[FRUSTUM_NEAR]   = row[3] + row[2];
+    frustumPlanes[FRUSTUM_FAR]    = row[3] - row[2];
+    for (glm::vec4& plane : frustumPlanes)
+        plane /= glm::length(glm::vec3(plane));
 }
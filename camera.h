@@ -23,12 +23,20 @@ const float PITCH = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ASPECT_RATIO = 4.0f / 3.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
 
-// Абстрактный класс камеры, который обрабатывает входные данные и вычисляет соответствующие углы Эйлера, векторы и матрицы для использования в OpenGL
+// Абстрактный класс камеры, который обрабатывает входные данные и вычисляет соответствующие углы Эйлера, векторы и матрицы для использования в OpenGL.
+// Матрицы и плоскости пирамиды видимости кэшируются и пересчитываются только после изменения камеры, поэтому
+// атрибуты ниже меняются только через методы класса
 class Camera
 {
 public:
+    // Индексы плоскостей пирамиды видимости
+    enum FrustumPlane { FRUSTUM_LEFT, FRUSTUM_RIGHT, FRUSTUM_BOTTOM, FRUSTUM_TOP, FRUSTUM_NEAR, FRUSTUM_FAR, FRUSTUM_PLANE_COUNT };
+
     // Атрибуты камеры
     glm::vec3 Position;
     glm::vec3 Front;
@@ -52,20 +60,70 @@ public:
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch);
 
     // Возвращаем матрицу вида, вычисленную с использованием углов Эйлера и LookAt-матрицы 
-    glm::mat4 GetViewMatrix();
+    const glm::mat4& GetViewMatrix() const;
+
+    // Возвращаем матрицу перспективной проекции с углом обзора Zoom и соотношением сторон кадрового буфера
+    const glm::mat4& GetProjectionMatrix() const;
+
+    // Возвращаем произведение проекции и вида
+    const glm::mat4& GetViewProjectionMatrix() const;
+
+    // Возвращаем FRUSTUM_PLANE_COUNT нормированных плоскостей (n, d) пирамиды видимости в мировых координатах:
+    // точка p внутри, если dot(n, p) + d >= 0 для всех плоскостей
+    const glm::vec4* GetFrustumPlanes() const;
+
+    // Задаем размеры кадрового буфера, по которым вычисляется соотношение сторон. Нулевые размеры (свернутое окно) игнорируются
+    void SetViewportSize(int width, int height);
+
+    // Задаем ближнюю и дальнюю плоскости отсечения
+    void SetClipPlanes(float nearDistance, float farDistance);
+
+    float GetAspectRatio() const { return aspectRatio; }
 
     // Обрабатываем входные данные, полученные от клавиатурной системы ввода. Принимаем входной параметр в виде определенного камерой перечисления (для абстрагирования его от оконных систем)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
 
-    // Обрабатываем входные данные, полученные от системы ввода с помощью мыши. Ожидаем в качестве параметров значения смещения как в направлении x, так и в направлении y
-    void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
+    // Обрабатываем входные данные, полученные от системы ввода с помощью мыши. Ожидаем в качестве параметров значения смещения как в направлении x, так и в направлении y.
+    // Смещения только накапливаются: за кадр может прийти много событий, а векторы камеры пересчитывает ApplyMouseMovement
+    void ProcessMouseMovement(float xoffset, float yoffset);
+
+    // Применяем смещения мыши, накопленные с прошлого вызова. Вызывается один раз за кадр
+    void ApplyMouseMovement(GLboolean constrainPitch = true);
 
     // Обрабатываем входные данные, полученные от события колеса прокрутки мыши. Интересуют только входные данные на вертикальную ось колесика 
     void ProcessMouseScroll(float yoffset);
 
+    // Устанавливаем позу камеры напрямую (например, при воспроизведении записанного пути). Накопленные смещения мыши отбрасываются.
+    // Векторы пересчитываются только при смене углов, проекция - только при смене Zoom
+    void SetPose(const glm::vec3& position, float yaw, float pitch, float zoom);
+
+    // Перемещаем камеру без поворота: устаревает только матрица вида
+    void SetPosition(const glm::vec3& position);
+
 private:
     // Вычисляем вектор-прямо по (обновленным) углам Эйлера камеры
     void updateCameraVectors();
+
+    // Пересчитываем устаревшие матрицы
+    void updateMatrices() const;
+
+    // Параметры проекции
+    float aspectRatio;
+    float nearPlane;
+    float farPlane;
+
+    // Смещения мыши, ожидающие ApplyMouseMovement
+    float pendingXOffset;
+    float pendingYOffset;
+
+    // Кэш матриц и плоскостей. Вид устаревает при движении и повороте, проекция - при изменении Zoom,
+    // соотношения сторон и плоскостей отсечения; произведение и плоскости - при любом из них
+    mutable glm::mat4 viewMatrix;
+    mutable glm::mat4 projectionMatrix;
+    mutable glm::mat4 viewProjectionMatrix;
+    mutable glm::vec4 frustumPlanes[FRUSTUM_PLANE_COUNT];
+    mutable bool viewDirty;
+    mutable bool projectionDirty;
 };
 #endif
 
@@ -0,0 +1,186 @@
+#include "camerapath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const char          MAGIC[4] = {'O', 'C', 'A', 'M'};
+    const std::uint32_t VERSION = 1;
+    const size_t        FLOATS_PER_POSE = 6;
+
+    struct FileHeader
+    {
+        char            magic[4];
+        std::uint32_t   version;
+        float           timeStep;
+        std::uint32_t   reserved;
+    };
+    static_assert(sizeof(FileHeader) == 16, "camera path header must stay 16 bytes");
+}
+
+
+
+CameraPathRecorder::~CameraPathRecorder()
+{
+    close();
+}
+
+
+
+bool CameraPathRecorder::open(const std::string& path, float timeStep)
+{
+    close();
+    m_file = std::fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        std::cout << "ERROR::CAMERA_PATH::CAN'T WRITE FILE " << path << std::endl;
+        return false;
+    }
+
+    m_timeStep = timeStep;
+    m_written = 0;
+
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.timeStep = timeStep;
+    header.reserved = 0;
+    std::fwrite(&header, sizeof(header), 1, m_file);
+    return true;
+}
+
+
+
+void CameraPathRecorder::close()
+{
+    if (m_file != nullptr)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+
+
+bool CameraPathRecorder::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+
+
+void CameraPathRecorder::record(const Camera& camera, double time)
+{
+    if (m_file == nullptr)
+        return;
+
+    // Обновления приходят неравномерно: дописываем текущую позу для каждого шага сетки, пройденного к этому моменту
+    unsigned long long steps = static_cast<unsigned long long>(std::floor(time / m_timeStep)) + 1;
+    const float pose[FLOATS_PER_POSE] = {
+        camera.Position.x, camera.Position.y, camera.Position.z,
+        camera.Yaw, camera.Pitch, camera.Zoom
+    };
+    for (; m_written < steps; m_written++)
+        std::fwrite(pose, sizeof(pose), 1, m_file);
+}
+
+
+
+bool CameraPathPlayer::load(const std::string& path)
+{
+    m_poses.clear();
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        std::cout << "ERROR::CAMERA_PATH::CAN'T READ FILE " << path << std::endl;
+        return false;
+    }
+
+    FileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || !(header.timeStep > 0.0f))
+    {
+        std::cout << "ERROR::CAMERA_PATH::INVALID FILE " << path << std::endl;
+        std::fclose(file);
+        return false;
+    }
+    m_timeStep = header.timeStep;
+
+    float pose[FLOATS_PER_POSE];
+    while (std::fread(pose, sizeof(pose), 1, file) == 1)
+    {
+        CameraPose p;
+        p.position = glm::vec3(pose[0], pose[1], pose[2]);
+        p.yaw = pose[3];
+        p.pitch = pose[4];
+        p.zoom = pose[5];
+        m_poses.push_back(p);
+    }
+    std::fclose(file);
+    return !m_poses.empty();
+}
+
+
+
+bool CameraPathPlayer::empty() const
+{
+    return m_poses.empty();
+}
+
+
+
+size_t CameraPathPlayer::size() const
+{
+    return m_poses.size();
+}
+
+
+
+float CameraPathPlayer::timeStep() const
+{
+    return m_timeStep;
+}
+
+
+
+double CameraPathPlayer::duration() const
+{
+    return m_poses.empty() ? 0.0 : static_cast<double>(m_poses.size() - 1) * m_timeStep;
+}
+
+
+
+CameraPose CameraPathPlayer::sample(double time) const
+{
+    if (m_poses.empty())
+        return CameraPose();
+
+    double position = std::max(time, 0.0) / m_timeStep;
+    size_t index = static_cast<size_t>(position);
+    if (index + 1 >= m_poses.size())
+        return m_poses.back();
+
+    float t = static_cast<float>(position - static_cast<double>(index));
+    const CameraPose& a = m_poses[index];
+    const CameraPose& b = m_poses[index + 1];
+
+    CameraPose result;
+    result.position = glm::mix(a.position, b.position, t);
+    result.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    result.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    result.zoom = a.zoom + (b.zoom - a.zoom) * t;
+    return result;
+}
+
+
+
+void CameraPathPlayer::apply(Camera& camera, double time) const
+{
+    CameraPose pose = sample(time);
+    camera.SetPose(pose.position, pose.yaw, pose.pitch, pose.zoom);
+}
@@ -0,0 +1,85 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "camera.h"
+
+// Поза камеры в один момент времени
+struct CameraPose
+{
+    glm::vec3 position{0.0f};
+    float yaw = YAW;
+    float pitch = PITCH;
+    float zoom = ZOOM;
+};
+
+// Формат файла пути камеры (порядок байтов и раскладка - как в памяти машины, файл не переносится между платформами):
+//   заголовок: "OCAM", uint32 версия, float шаг времени, uint32 зарезервировано
+//   записи:    6 float на каждый шаг (position.xyz, yaw, pitch, zoom)
+// Моменты времени записей неявные: i-я запись соответствует времени i * шаг.
+
+/**
+ * @brief CameraPathRecorder - Записывает позы камеры с фиксированным шагом времени,
+ * независимо от того, с какой частотой и неравномерностью приходят обновления.
+ */
+class CameraPathRecorder
+{
+public:
+    CameraPathRecorder() = default;
+    ~CameraPathRecorder();
+    CameraPathRecorder(const CameraPathRecorder&) = delete;
+    CameraPathRecorder& operator=(const CameraPathRecorder&) = delete;
+
+    bool open(const std::string& path, float timeStep = 1.0f / 60.0f);
+    void close();
+    bool isOpen() const;
+
+    /**
+     * @brief record - Дописываем позу камеры для всех шагов, пройденных к моменту времени time.
+     * @param camera - Текущее состояние камеры.
+     * @param time - Время в секундах от начала записи.
+     */
+    void record(const Camera& camera, double time);
+
+private:
+    std::FILE*          m_file = nullptr;
+    float               m_timeStep = 1.0f / 60.0f;
+    unsigned long long  m_written = 0;
+};
+
+/**
+ * @brief CameraPathPlayer - Воспроизводит записанный путь камеры с фиксированным шагом времени.
+ */
+class CameraPathPlayer
+{
+public:
+    bool load(const std::string& path);
+
+    bool empty() const;
+    size_t size() const;
+    float timeStep() const;
+
+    // Длительность пути в секундах
+    double duration() const;
+
+    /**
+     * @brief sample - Поза в момент времени time (линейная интерполяция между соседними шагами).
+     */
+    CameraPose sample(double time) const;
+
+    /**
+     * @brief apply - Устанавливаем камере позу для момента времени time.
+     */
+    void apply(Camera& camera, double time) const;
+
+private:
+    std::vector<CameraPose> m_poses;
+    float                   m_timeStep = 1.0f / 60.0f;
+};
+
+#endif // CAMERA_PATH_H
@@ -0,0 +1,238 @@
+#include "clusteredlighting.h"
+#include "cpuprofiler.h"
+#include "Simd.hpp"
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const GLenum TEXTURE_FORMATS[3] = { GL_RG32UI, GL_R16UI, GL_RGBA32F };
+    const GLenum TEXTURE_UNITS[3] = {
+        GL_TEXTURE0 + TEXTURE_UNIT_CLUSTER_GRID,
+        GL_TEXTURE0 + TEXTURE_UNIT_CLUSTER_LIGHT_INDICES,
+        GL_TEXTURE0 + TEXTURE_UNIT_CLUSTER_LIGHTS
+    };
+
+    // Перезаливаем буфер целиком: старое содержимое отдается драйверу (orphaning), и кадр не ждет GPU.
+    // Пустой буфер texture buffer'а недопустим, поэтому размер не меньше одного элемента
+    void uploadBuffer(GLuint buffer, const void* data, size_t bytes, size_t minimumBytes)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(std::max(bytes, minimumBytes)), nullptr, GL_STREAM_DRAW);
+        if (bytes > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
+    }
+}
+
+
+
+ClusteredLighting::ClusteredLighting()
+    : m_minX(CLUSTER_COUNT), m_minY(CLUSTER_COUNT), m_minZ(CLUSTER_COUNT),
+      m_maxX(CLUSTER_COUNT), m_maxY(CLUSTER_COUNT), m_maxZ(CLUSTER_COUNT),
+      m_clusterLights(static_cast<size_t>(CLUSTER_COUNT) * MAX_LIGHTS_PER_CLUSTER),
+      m_clusterCounts(CLUSTER_COUNT),
+      m_grid(static_cast<size_t>(CLUSTER_COUNT) * 2)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        m_buffers[i] = BufferHandle::create();
+        m_textures[i] = TextureHandle::create();
+        uploadBuffer(m_buffers[i], nullptr, 0, 16);
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, TEXTURE_FORMATS[i], m_buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+
+
+void ClusteredLighting::update(const FrameState& state, ThreadPool& workers)
+{
+    PROFILE_ZONE("ClusteredLighting::update");
+
+    if (state.projection != m_boundsProjection)
+        buildClusterBounds(state.projection);
+    if (state.framebufferWidth > 0 && state.framebufferHeight > 0)
+        m_tileSize = glm::vec2(static_cast<float>(state.framebufferWidth) / CLUSTERS_X,
+                               static_cast<float>(state.framebufferHeight) / CLUSTERS_Y);
+
+    // Источники в пространстве вида для распределения и в мировом - для шейдера (освещение считается в мировых координатах)
+    m_lightCount = std::min(state.pointLightCount, MAX_POINT_LIGHTS);
+    size_t padded = (m_lightCount + 3) & ~static_cast<size_t>(3);
+    m_lightX.assign(padded, 0.0f);
+    m_lightY.assign(padded, 0.0f);
+    m_lightZ.assign(padded, 0.0f);
+    m_lightRadius2.assign(padded, -1.0f);
+    m_lightData.resize(m_lightCount * 2);
+    for (size_t i = 0; i < m_lightCount; i++)
+    {
+        const PointLight& light = state.pointLights[i];
+        glm::vec4 viewPosition = state.view * glm::vec4(light.position, 1.0f);
+        m_lightX[i] = viewPosition.x;
+        m_lightY[i] = viewPosition.y;
+        m_lightZ[i] = viewPosition.z;
+        m_lightRadius2[i] = light.radius * light.radius;
+        m_lightData[i * 2] = glm::vec4(light.position, light.radius);
+        m_lightData[i * 2 + 1] = glm::vec4(light.color, light.intensity);
+    }
+
+    // Срезы независимы: каждый пишет только в свои кластеры
+    if (m_lightCount > 0)
+    {
+        workers.parallelFor(CLUSTERS_Z, 1, [this](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++)
+                binSlice(static_cast<unsigned int>(z));
+        });
+    }
+    else
+    {
+        std::fill(m_clusterCounts.begin(), m_clusterCounts.end(), 0u);
+    }
+
+    // Упаковываем списки кластеров подряд
+    m_indices.clear();
+    for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        std::uint32_t count = m_clusterCounts[cluster];
+        m_grid[cluster * 2] = static_cast<std::uint32_t>(m_indices.size());
+        m_grid[cluster * 2 + 1] = count;
+        const std::uint16_t* first = &m_clusterLights[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER];
+        m_indices.insert(m_indices.end(), first, first + count);
+    }
+
+    uploadBuffer(m_buffers[0], m_grid.data(), m_grid.size() * sizeof(std::uint32_t), 16);
+    uploadBuffer(m_buffers[1], m_indices.data(), m_indices.size() * sizeof(std::uint16_t), 16);
+    uploadBuffer(m_buffers[2], m_lightData.data(), m_lightData.size() * sizeof(glm::vec4), 16);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        glActiveTexture(TEXTURE_UNITS[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+
+
+void ClusteredLighting::apply(const Shader& shader) const
+{
+    // Срез по глубине d: floor(log(d) * scale + bias), так что срез 0 начинается на ближней плоскости, последний - на дальней
+    float scale = static_cast<float>(CLUSTERS_Z) / std::log(m_far / m_near);
+    float bias = -std::log(m_near) * scale;
+
+    glUniform3i(glGetUniformLocation(shader.ID(), "clusterDims"), CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+    shader.setVec2("clusterTileSize", m_tileSize);
+    shader.setVec2("clusterDepthParams", scale, bias);
+}
+
+
+
+size_t ClusteredLighting::indexCount() const
+{
+    return m_indices.size();
+}
+
+
+
+void ClusteredLighting::buildClusterBounds(const glm::mat4& projection)
+{
+    m_boundsProjection = projection;
+
+    // Ближняя и дальняя плоскости из перспективной матрицы
+    m_near = projection[3][2] / (projection[2][2] - 1.0f);
+    m_far = projection[3][2] / (projection[2][2] + 1.0f);
+
+    for (unsigned int z = 0; z < CLUSTERS_Z; z++)
+    {
+        float sliceNear = m_near * std::pow(m_far / m_near, static_cast<float>(z) / CLUSTERS_Z);
+        float sliceFar = m_near * std::pow(m_far / m_near, static_cast<float>(z + 1) / CLUSTERS_Z);
+        for (unsigned int y = 0; y < CLUSTERS_Y; y++)
+        {
+            for (unsigned int x = 0; x < CLUSTERS_X; x++)
+            {
+                // Углы тайла в NDC, перенесенные на глубины среза: x_view = d * (x_ndc + P[2][0]) / P[0][0]
+                float ndcX[2] = { -1.0f + 2.0f * x / CLUSTERS_X, -1.0f + 2.0f * (x + 1) / CLUSTERS_X };
+                float ndcY[2] = { -1.0f + 2.0f * y / CLUSTERS_Y, -1.0f + 2.0f * (y + 1) / CLUSTERS_Y };
+                glm::vec3 low(INFINITY);
+                glm::vec3 high(-INFINITY);
+                for (float depth : { sliceNear, sliceFar })
+                {
+                    for (int i = 0; i < 2; i++)
+                    {
+                        for (int j = 0; j < 2; j++)
+                        {
+                            glm::vec3 corner(depth * (ndcX[i] + projection[2][0]) / projection[0][0],
+                                             depth * (ndcY[j] + projection[2][1]) / projection[1][1],
+                                             -depth);
+                            low = glm::min(low, corner);
+                            high = glm::max(high, corner);
+                        }
+                    }
+                }
+
+                unsigned int cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+                m_minX[cluster] = low.x;
+                m_minY[cluster] = low.y;
+                m_minZ[cluster] = low.z;
+                m_maxX[cluster] = high.x;
+                m_maxY[cluster] = high.y;
+                m_maxZ[cluster] = high.z;
+            }
+        }
+    }
+}
+
+
+
+void ClusteredLighting::binSlice(unsigned int z)
+{
+    const size_t padded = m_lightX.size();
+    const unsigned int first = z * CLUSTERS_X * CLUSTERS_Y;
+    for (unsigned int cluster = first; cluster < first + CLUSTERS_X * CLUSTERS_Y; cluster++)
+    {
+        std::uint16_t* out = &m_clusterLights[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER];
+        std::uint32_t count = 0;
+
+        // Квадрат расстояния от центра сферы до AABB: сумма по осям max(min - c, 0) + max(c - max, 0), в квадрате
+#ifdef ONION_SIMD_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 minX = _mm_set1_ps(m_minX[cluster]);
+        const __m128 minY = _mm_set1_ps(m_minY[cluster]);
+        const __m128 minZ = _mm_set1_ps(m_minZ[cluster]);
+        const __m128 maxX = _mm_set1_ps(m_maxX[cluster]);
+        const __m128 maxY = _mm_set1_ps(m_maxY[cluster]);
+        const __m128 maxZ = _mm_set1_ps(m_maxZ[cluster]);
+        for (size_t i = 0; i < padded && count < MAX_LIGHTS_PER_CLUSTER; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&m_lightX[i]);
+            __m128 y = _mm_loadu_ps(&m_lightY[i]);
+            __m128 zc = _mm_loadu_ps(&m_lightZ[i]);
+            __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, x), zero), _mm_max_ps(_mm_sub_ps(x, maxX), zero));
+            __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, y), zero), _mm_max_ps(_mm_sub_ps(y, maxY), zero));
+            __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, zc), zero), _mm_max_ps(_mm_sub_ps(zc, maxZ), zero));
+            __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_loadu_ps(&m_lightRadius2[i])));
+            for (int lane = 0; mask != 0 && count < MAX_LIGHTS_PER_CLUSTER; lane++, mask >>= 1)
+            {
+                if (mask & 1)
+                    out[count++] = static_cast<std::uint16_t>(i + lane);
+            }
+        }
+#else
+        for (size_t i = 0; i < padded && count < MAX_LIGHTS_PER_CLUSTER; i++)
+        {
+            float dx = std::max(m_minX[cluster] - m_lightX[i], 0.0f) + std::max(m_lightX[i] - m_maxX[cluster], 0.0f);
+            float dy = std::max(m_minY[cluster] - m_lightY[i], 0.0f) + std::max(m_lightY[i] - m_maxY[cluster], 0.0f);
+            float dz = std::max(m_minZ[cluster] - m_lightZ[i], 0.0f) + std::max(m_lightZ[i] - m_maxZ[cluster], 0.0f);
+            if (dx * dx + dy * dy + dz * dz <= m_lightRadius2[i])
+                out[count++] = static_cast<std::uint16_t>(i);
+        }
+#endif
+        m_clusterCounts[cluster] = count;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "FrameState.hpp"
+#include "glresource.h"
+#include "shader.h"
+#include "threadpool.h"
+
+/**
+ * @brief ClusteredLighting - Кластерное прямое освещение. Пирамида видимости делится на кластеры: тайлы экрана
+ * CLUSTERS_X x CLUSTERS_Y и CLUSTERS_Z срезов по глубине с экспоненциальным шагом. Каждый кадр точечные источники
+ * распределяются по кластерам на CPU (тест сфера-AABB по четыре источника за раз, срезы - на рабочих потоках),
+ * а результат загружается в texture buffer'ы, которые читает вариант шейдера CLUSTERED:
+ *   clusterGrid         - RG32UI, на кластер: смещение и число индексов
+ *   clusterLightIndices - R16UI, индексы источников подряд для всех кластеров
+ *   clusterLights       - RGBA32F, на источник два текселя: (позиция, радиус) и (цвет, яркость)
+ * Требует текущий GL-контекст.
+ */
+class ClusteredLighting
+{
+public:
+    static const unsigned int CLUSTERS_X = 16;
+    static const unsigned int CLUSTERS_Y = 9;
+    static const unsigned int CLUSTERS_Z = 24;
+    static const unsigned int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+    // Источники сверх этого числа в одном кластере отбрасываются
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 64;
+
+    ClusteredLighting();
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    /**
+     * @brief update - Распределяем источники снимка по кластерам, загружаем сетку и привязываем буферы к их юнитам.
+     * @param state - Снимок кадра (камера, размеры кадра, точечные источники).
+     * @param workers - Потоки для распределения срезов.
+     */
+    void update(const FrameState& state, ThreadPool& workers);
+
+    /**
+     * @brief apply - Устанавливаем программе варианта CLUSTERED параметры сетки текущего кадра.
+     */
+    void apply(const Shader& shader) const;
+
+    // Суммарное число ссылок кластеров на источники в последнем кадре
+    size_t indexCount() const;
+
+private:
+    void buildClusterBounds(const glm::mat4& projection);
+    void binSlice(unsigned int z);
+
+private:
+    // AABB кластеров в пространстве вида (структура массивов, индекс = (z * CLUSTERS_Y + y) * CLUSTERS_X + x)
+    std::vector<float>          m_minX, m_minY, m_minZ;
+    std::vector<float>          m_maxX, m_maxY, m_maxZ;
+    glm::mat4                   m_boundsProjection{0.0f};  // Проекция, для которой построены AABB
+    float                       m_near = 0.1f;
+    float                       m_far = 100.0f;
+
+    // Источники текущего кадра в пространстве вида, дополненные до кратного четырем (радиус^2 < 0 не пересекает ничего)
+    std::vector<float>          m_lightX, m_lightY, m_lightZ, m_lightRadius2;
+    size_t                      m_lightCount = 0;
+
+    // Результат распределения: по MAX_LIGHTS_PER_CLUSTER мест на кластер, затем упаковка без пропусков
+    std::vector<std::uint16_t>  m_clusterLights;
+    std::vector<std::uint32_t>  m_clusterCounts;
+    std::vector<std::uint32_t>  m_grid;
+    std::vector<std::uint16_t>  m_indices;
+    std::vector<glm::vec4>      m_lightData;
+
+    glm::vec2                   m_tileSize{1.0f};
+
+    // Буферы и текстуры texture buffer'ов: сетка, индексы, источники
+    BufferHandle                m_buffers[3];
+    TextureHandle               m_textures[3];
+};
+
+#endif // CLUSTERED_LIGHTING_H
@@ -0,0 +1,126 @@
+#include "cpuprofiler.h"
+
+#ifdef ONION_PROFILE
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    const unsigned int RING_CAPACITY = 1u << 16;   // Зон на поток; при переполнении затираются самые старые
+
+    struct ZoneEvent
+    {
+        const char*         name;
+        unsigned long long  beginNs;
+        unsigned long long  endNs;
+    };
+
+    // Кольцевой буфер одного потока. Пишет только поток-владелец, поэтому запись не требует блокировок
+    struct ThreadBuffer
+    {
+        std::vector<ZoneEvent>              events = std::vector<ZoneEvent>(RING_CAPACITY);
+        std::atomic<unsigned long long>     head{0};
+        unsigned int                        threadId = 0;
+        std::string                         threadName;
+    };
+
+    // Буферы принадлежат реестру, а не потокам, чтобы зоны завершившихся потоков попали в экспорт
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+    ThreadBuffer& threadBuffer()
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            registry.push_back(std::make_unique<ThreadBuffer>());
+            buffer = registry.back().get();
+            buffer->threadId = static_cast<unsigned int>(registry.size());
+        }
+        return *buffer;
+    }
+
+    void writeEscaped(std::ofstream& file, const std::string& text)
+    {
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                file << '\\';
+            file << c;
+        }
+    }
+}
+
+
+
+void CpuProfiler::record(const char* name, unsigned long long beginNs, unsigned long long endNs)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    unsigned long long head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % RING_CAPACITY] = {name, beginNs, endNs};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer.threadName = name;
+}
+
+
+
+bool CpuProfiler::exportChromeTrace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CPU_PROFILER::CAN'T WRITE FILE " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : registry)
+    {
+        if (!buffer->threadName.empty())
+        {
+            if (!first)
+                file << ",\n";
+            first = false;
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"args\":{\"name\":\"";
+            writeEscaped(file, buffer->threadName);
+            file << "\"}}";
+        }
+
+        unsigned long long head = buffer->head.load(std::memory_order_acquire);
+        unsigned long long begin = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+        for (unsigned long long i = begin; i < head; i++)
+        {
+            const ZoneEvent& event = buffer->events[i % RING_CAPACITY];
+            if (!first)
+                file << ",\n";
+            first = false;
+            file << "{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << static_cast<double>(event.beginNs) / 1000.0
+                 << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) / 1000.0 << "}";
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
+
+#endif // ONION_PROFILE
@@ -0,0 +1,68 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+// Инструментирование CPU включается макросом ONION_PROFILE (qmake CONFIG+=profile_zones).
+// Без него макросы PROFILE_* раскрываются в пустые выражения и профайлер полностью исчезает из сборки.
+//
+// PROFILE_ZONE("name")         - измерить время до конца текущей области видимости
+// PROFILE_THREAD_NAME("name")  - подписать текущий поток в трассе
+// PROFILE_EXPORT("file.json")  - сохранить все зоны в формате Chrome trace_event (chrome://tracing)
+
+#ifdef ONION_PROFILE
+
+#include <chrono>
+#include <string>
+
+namespace CpuProfiler
+{
+    // Время в наносекундах от запуска профайлера
+    inline unsigned long long now()
+    {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    /**
+     * @brief record - Записываем завершенную зону в кольцевой буфер текущего потока.
+     * @param name - Имя зоны (строка должна жить до экспорта, например литерал).
+     */
+    void record(const char* name, unsigned long long beginNs, unsigned long long endNs);
+
+    void setThreadName(const char* name);
+
+    /**
+     * @brief exportChromeTrace - Сохраняем зоны всех потоков. Вызывать, когда инструментированные потоки
+     * уже завершились или остановлены, иначе последние записи могут оказаться неполными.
+     */
+    bool exportChromeTrace(const std::string& path);
+
+    // RAII-зона: время начала берется в конструкторе, запись делается в деструкторе
+    class Zone
+    {
+    public:
+        explicit Zone(const char* name) : m_name(name), m_begin(now()) {}
+        ~Zone() { record(m_name, m_begin, now()); }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    private:
+        const char*         m_name;
+        unsigned long long  m_begin;
+    };
+}
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) CpuProfiler::Zone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) CpuProfiler::setThreadName(name)
+#define PROFILE_EXPORT(path) CpuProfiler::exportChromeTrace(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_EXPORT(path) ((void)0)
+
+#endif // ONION_PROFILE
+
+#endif // CPU_PROFILER_H
@@ -0,0 +1,97 @@
+#include "gbuffer.h"
+#include "Texture.hpp"
+
+#include <iostream>
+
+namespace
+{
+    void allocateTexture(GLuint texture, GLint internalFormat, int width, int height, GLenum format, GLenum type)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        // Проход освещения читает вложения texelFetch'ем, фильтрация и мипмапы не нужны
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+}
+
+
+
+GBuffer::GBuffer()
+{
+    m_framebuffer = FramebufferHandle::create();
+    m_albedo = TextureHandle::create();
+    m_normal = TextureHandle::create();
+    m_depth = TextureHandle::create();
+
+    m_resources[0] = GpuMemory::trackTexture(m_albedo, GPU_MEMORY_RENDER_TARGETS);
+    m_resources[1] = GpuMemory::trackTexture(m_normal, GPU_MEMORY_RENDER_TARGETS);
+    m_resources[2] = GpuMemory::trackTexture(m_depth, GPU_MEMORY_RENDER_TARGETS);
+}
+
+
+
+GBuffer::~GBuffer()
+{
+    for (GpuMemory::ResourceId resource : m_resources)
+        GpuMemory::release(resource);
+}
+
+
+
+void GBuffer::resize(int width, int height)
+{
+    if (width == m_width && height == m_height)
+        return;
+    m_width = width;
+    m_height = height;
+
+    allocateTexture(m_albedo, GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE);
+    allocateTexture(m_normal, GL_RG16, width, height, GL_RG, GL_UNSIGNED_SHORT);
+    allocateTexture(m_depth, GL_DEPTH_COMPONENT24, width, height, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    for (GpuMemory::ResourceId resource : m_resources)
+        GpuMemory::refresh(resource);
+
+    // Перепривязываем только точку рисования: привязка чтения вызывающего кода не меняется
+    GLint previous = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedo, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normal, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previous));
+}
+
+
+
+void GBuffer::bindForWriting()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    // Нулевой альфа-канал альбедо - ID материала 0; цвет очистки кадра при этом не меняется
+    const GLfloat zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+}
+
+
+
+void GBuffer::bindTextures() const
+{
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_GBUFFER_ALBEDO);
+    glBindTexture(GL_TEXTURE_2D, m_albedo);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_GBUFFER_NORMAL);
+    glBindTexture(GL_TEXTURE_2D, m_normal);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_GBUFFER_DEPTH);
+    glBindTexture(GL_TEXTURE_2D, m_depth);
+    glActiveTexture(GL_TEXTURE0);
+}
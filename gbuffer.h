@@ -0,0 +1,49 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include "glresource.h"
+#include "gpumemory.h"
+
+/**
+ * @brief GBuffer - Компактный G-буфер отложенного освещения (8 байт цвета и 3 байта глубины на пиксель):
+ *   0: RGBA8  - альбедо и ID материала (0 - пиксель без освещаемой геометрии)
+ *   1: RG16   - нормаль в мировых координатах в октаэдрической упаковке
+ *   глубина: DEPTH_COMPONENT24, по ней проход освещения восстанавливает позицию
+ * Требует текущий GL-контекст.
+ */
+class GBuffer
+{
+public:
+    GBuffer();
+    ~GBuffer();
+    GBuffer(const GBuffer&) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
+    /**
+     * @brief resize - Пересоздаем вложения, если размер кадра изменился.
+     */
+    void resize(int width, int height);
+
+    /**
+     * @brief bindForWriting - Делаем G-буфер текущим кадровым буфером и очищаем его.
+     */
+    void bindForWriting();
+
+    /**
+     * @brief bindTextures - Привязываем вложения к юнитам сэмплеров gAlbedo, gNormal, gDepth.
+     */
+    void bindTextures() const;
+
+private:
+    FramebufferHandle   m_framebuffer;
+    TextureHandle       m_albedo;
+    TextureHandle       m_normal;
+    TextureHandle       m_depth;
+    GpuMemory::ResourceId m_resources[3] = {};  // Учет альбедо, нормалей и глубины
+    int     m_width = 0;
+    int     m_height = 0;
+};
+
+#endif // GBUFFER_H
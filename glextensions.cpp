@@ -0,0 +1,81 @@
+#include "glextensions.h"
+
+#include <cstring>
+
+namespace GLExtensions
+{
+    PFNONIONGETPROGRAMBINARYPROC    getProgramBinary = nullptr;
+    PFNONIONPROGRAMBINARYPROC       programBinary = nullptr;
+    PFNONIONPROGRAMPARAMETERIPROC   programParameteri = nullptr;
+    PFNONIONMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads = nullptr;
+
+    static bool s_programBinarySupported = false;
+    static bool s_parallelShaderCompileSupported = false;
+}
+
+
+
+void GLExtensions::load(GLADloadproc loader)
+{
+    if (hasVersion(4, 1) || has("GL_ARB_get_program_binary"))
+    {
+        getProgramBinary = reinterpret_cast<PFNONIONGETPROGRAMBINARYPROC>(loader("glGetProgramBinary"));
+        programBinary = reinterpret_cast<PFNONIONPROGRAMBINARYPROC>(loader("glProgramBinary"));
+        programParameteri = reinterpret_cast<PFNONIONPROGRAMPARAMETERIPROC>(loader("glProgramParameteri"));
+    }
+
+    GLint formats = 0;
+    if (getProgramBinary != nullptr && programBinary != nullptr && programParameteri != nullptr)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    s_programBinarySupported = formats > 0;
+
+    if (has("GL_KHR_parallel_shader_compile"))
+        maxShaderCompilerThreads = reinterpret_cast<PFNONIONMAXSHADERCOMPILERTHREADSPROC>(loader("glMaxShaderCompilerThreadsKHR"));
+    else if (has("GL_ARB_parallel_shader_compile"))
+        maxShaderCompilerThreads = reinterpret_cast<PFNONIONMAXSHADERCOMPILERTHREADSPROC>(loader("glMaxShaderCompilerThreadsARB"));
+    s_parallelShaderCompileSupported = maxShaderCompilerThreads != nullptr;
+
+    // 0xFFFFFFFF - число потоков выбирает драйвер
+    if (s_parallelShaderCompileSupported)
+        maxShaderCompilerThreads(0xFFFFFFFFu);
+}
+
+
+
+bool GLExtensions::has(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension != nullptr && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+
+
+bool GLExtensions::hasVersion(int major, int minor)
+{
+    GLint contextMajor = 0;
+    GLint contextMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+    return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+}
+
+
+
+bool GLExtensions::programBinarySupported()
+{
+    return s_programBinarySupported;
+}
+
+
+
+bool GLExtensions::parallelShaderCompileSupported()
+{
+    return s_parallelShaderCompileSupported;
+}
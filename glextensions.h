@@ -0,0 +1,74 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// glad сгенерирован только для ядра GL 3.3 без расширений. Здесь загружаются функции более новых версий
+// и расширений, которые используются опционально: если драйвер их не предоставляет, указатели остаются nullptr.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// GL_NVX_gpu_memory_info / GL_ATI_meminfo (только перечисления, функций у расширений нет)
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#endif
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+typedef void (APIENTRYP PFNONIONGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNONIONPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNONIONPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNONIONMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+namespace GLExtensions
+{
+    /**
+     * @brief load - Загружаем указатели на функции расширений. Вызывается после gladLoadGLLoader
+     * в потоке, в котором текущим является GL-контекст.
+     * @param loader - Та же функция получения адресов, что передавалась в glad.
+     */
+    void load(GLADloadproc loader);
+
+    /**
+     * @brief has - Поддерживает ли текущий контекст расширение с указанным именем.
+     */
+    bool has(const char* name);
+
+    /**
+     * @brief hasVersion - Версия контекста не ниже major.minor.
+     */
+    bool hasVersion(int major, int minor);
+
+    // GL 4.1 / GL_ARB_get_program_binary
+    extern PFNONIONGETPROGRAMBINARYPROC     getProgramBinary;
+    extern PFNONIONPROGRAMBINARYPROC        programBinary;
+    extern PFNONIONPROGRAMPARAMETERIPROC    programParameteri;
+
+    // Доступен ли кэш бинарных программ (функции загружены и драйвер поддерживает хотя бы один формат)
+    bool programBinarySupported();
+
+    // GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+    extern PFNONIONMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads;
+
+    // Можно ли опрашивать GL_COMPLETION_STATUS_KHR без ожидания. При загрузке драйверу разрешается
+    // использовать столько потоков компилятора, сколько он сочтет нужным
+    bool parallelShaderCompileSupported();
+}
+
+#endif // GL_EXTENSIONS_H
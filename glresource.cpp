@@ -0,0 +1,137 @@
+#include "glresource.h"
+#include "cpuprofiler.h"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const size_t OBJECT_TYPE_COUNT = static_cast<size_t>(GLObject::Count);
+
+    // Имена одного кадра по типам: каждый тип удаляется одним вызовом glDelete*
+    struct Batch
+    {
+        GLsync              fence = nullptr;
+        std::vector<GLuint> names[OBJECT_TYPE_COUNT];
+    };
+
+    std::mutex          s_mutex;
+    Batch               s_current;      // Освобожденные с прошлого endFrame, забора еще нет
+    std::deque<Batch>   s_fenced;       // Ждут своих заборов, от старых к новым
+    size_t              s_pending = 0;
+
+    void deleteNames(Batch& batch)
+    {
+        for (size_t type = 0; type < OBJECT_TYPE_COUNT; type++)
+        {
+            std::vector<GLuint>& names = batch.names[type];
+            if (names.empty())
+                continue;
+            GLsizei count = static_cast<GLsizei>(names.size());
+            switch (static_cast<GLObject>(type))
+            {
+            case GLObject::Buffer:          glDeleteBuffers(count, names.data()); break;
+            case GLObject::VertexArray:     glDeleteVertexArrays(count, names.data()); break;
+            case GLObject::Texture:         glDeleteTextures(count, names.data()); break;
+            case GLObject::Framebuffer:     glDeleteFramebuffers(count, names.data()); break;
+            case GLObject::Renderbuffer:    glDeleteRenderbuffers(count, names.data()); break;
+            case GLObject::Program:
+                for (GLuint name : names)
+                    glDeleteProgram(name);
+                break;
+            case GLObject::Shader:
+                for (GLuint name : names)
+                    glDeleteShader(name);
+                break;
+            case GLObject::Count:           break;
+            }
+            s_pending -= names.size();
+            names.clear();
+        }
+        if (batch.fence != nullptr)
+            glDeleteSync(batch.fence);
+        batch.fence = nullptr;
+    }
+
+    bool empty(const Batch& batch)
+    {
+        for (const std::vector<GLuint>& names : batch.names)
+            if (!names.empty())
+                return false;
+        return true;
+    }
+}
+
+
+
+void GLDeletionQueue::enqueue(GLObject type, GLuint name)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_current.names[static_cast<size_t>(type)].push_back(name);
+    s_pending++;
+}
+
+
+
+void GLDeletionQueue::endFrame()
+{
+    PROFILE_ZONE("GLDeletionQueue::endFrame");
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (!empty(s_current))
+    {
+        s_current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s_fenced.push_back(std::move(s_current));
+        s_current = Batch();
+    }
+
+    // Нулевой таймаут: только опрашиваем. Команды кадра отправит обмен буферов, поэтому забор рано или поздно пройдет
+    while (!s_fenced.empty())
+    {
+        GLenum status = glClientWaitSync(s_fenced.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        deleteNames(s_fenced.front());
+        s_fenced.pop_front();
+    }
+}
+
+
+
+void GLDeletionQueue::flush()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (Batch& batch : s_fenced)
+        deleteNames(batch);
+    s_fenced.clear();
+    deleteNames(s_current);
+}
+
+
+
+size_t GLDeletionQueue::pending()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_pending;
+}
+
+
+
+GLuint GLDeletionQueue::create(GLObject type)
+{
+    GLuint name = 0;
+    switch (type)
+    {
+    case GLObject::Buffer:          glGenBuffers(1, &name); break;
+    case GLObject::VertexArray:     glGenVertexArrays(1, &name); break;
+    case GLObject::Texture:         glGenTextures(1, &name); break;
+    case GLObject::Framebuffer:     glGenFramebuffers(1, &name); break;
+    case GLObject::Renderbuffer:    glGenRenderbuffers(1, &name); break;
+    case GLObject::Program:         name = glCreateProgram(); break;
+    case GLObject::Shader:          break;
+    case GLObject::Count:           break;
+    }
+    return name;
+}
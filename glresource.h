@@ -0,0 +1,96 @@
+#ifndef GL_RESOURCE_H
+#define GL_RESOURCE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Типы GL-объектов, которыми владеют GLHandle
+enum class GLObject : unsigned int
+{
+    Buffer = 0,
+    VertexArray,
+    Texture,
+    Framebuffer,
+    Renderbuffer,
+    Program,
+    Shader,         // Стадия программы: создается glCreateShader(тип), поэтому только через GLHandle(name)
+
+    Count
+};
+
+// Отложенное удаление GL-объектов. Имена, освобожденные за кадр, удаляются пакетом только после того, как GPU
+// дошел до конца этого кадра (glFenceSync в endFrame). Так удаление объекта, который еще читают команды
+// в очереди, не заставляет драйвер ждать GPU посреди кадра.
+namespace GLDeletionQueue
+{
+    // Ставим имя в очередь на удаление. Можно вызывать из любого потока
+    void enqueue(GLObject type, GLuint name);
+
+    /**
+     * @brief endFrame - Закрываем кадр забором для имен, освобожденных с прошлого вызова,
+     * и удаляем имена кадров, заборы которых уже пройдены. Не ждет GPU. Вызывается в потоке GL-контекста.
+     */
+    void endFrame();
+
+    // Удаляем все имена сразу, не дожидаясь заборов (перед уничтожением контекста)
+    void flush();
+
+    // Сколько имен ждут удаления
+    size_t pending();
+
+    // Создаем объект указанного типа (glGen* / glCreateProgram); для GLObject::Shader возвращает 0
+    GLuint create(GLObject type);
+}
+
+/**
+ * @brief GLHandle - Единственный владелец имени GL-объекта. Только перемещается; при уничтожении или reset
+ * имя уходит в GLDeletionQueue. Неявно приводится к GLuint, поэтому передается в gl* функции как есть.
+ */
+template <GLObject TYPE>
+class GLHandle
+{
+public:
+    GLHandle() = default;
+    explicit GLHandle(GLuint name) : m_name(name) {}    // Забираем владение уже созданным объектом
+    ~GLHandle() { reset(); }
+
+    GLHandle(GLHandle&& other) noexcept : m_name(other.m_name) { other.m_name = 0; }
+    GLHandle& operator=(GLHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            m_name = other.m_name;
+            other.m_name = 0;
+        }
+        return *this;
+    }
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    static GLHandle create() { return GLHandle(GLDeletionQueue::create(TYPE)); }
+
+    GLuint get() const { return m_name; }
+    operator GLuint() const { return m_name; }
+
+    void reset()
+    {
+        if (m_name != 0)
+            GLDeletionQueue::enqueue(TYPE, m_name);
+        m_name = 0;
+    }
+
+private:
+    GLuint m_name = 0;
+};
+
+using BufferHandle = GLHandle<GLObject::Buffer>;
+using VertexArrayHandle = GLHandle<GLObject::VertexArray>;
+using TextureHandle = GLHandle<GLObject::Texture>;
+using FramebufferHandle = GLHandle<GLObject::Framebuffer>;
+using RenderbufferHandle = GLHandle<GLObject::Renderbuffer>;
+using ProgramHandle = GLHandle<GLObject::Program>;
+using ShaderHandle = GLHandle<GLObject::Shader>;
+
+#endif // GL_RESOURCE_H
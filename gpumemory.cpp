@@ -0,0 +1,467 @@
+#include "gpumemory.h"
+#include "glextensions.h"
+#include "cpuprofiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+    struct Resource
+    {
+        GLuint              name = 0;
+        GpuMemoryCategory   category = GPU_MEMORY_VERTICES;
+        size_t              bytes = 0;
+        size_t              fullBytes = 0;      // Размер текстуры до отбрасывания уровней (при учете или refresh)
+        unsigned long long  lastUsed = 0;       // Номер кадра последнего use
+        bool                texture = false;
+        bool                evictable = false;
+        bool                evicted = false;
+        bool                restoreRequested = false;
+        bool                live = false;
+    };
+
+    std::vector<Resource>               s_resources;    // Индекс - ResourceId - 1
+    std::vector<GpuMemory::ResourceId>  s_freeIds;
+    size_t                              s_categoryBytes[GPU_MEMORY_CATEGORY_COUNT] = {};
+    std::atomic<size_t>                 s_budget(0);
+    unsigned long long                  s_frame = 1;
+
+    const char* const CATEGORY_NAMES[GPU_MEMORY_CATEGORY_COUNT] = {
+        "vertices",
+        "indices",
+        "instances",
+        "textures",
+        "targets"
+    };
+
+    Resource* find(GpuMemory::ResourceId id)
+    {
+        if (id == GpuMemory::NO_RESOURCE || id > s_resources.size() || !s_resources[id - 1].live)
+            return nullptr;
+        return &s_resources[id - 1];
+    }
+
+    GpuMemory::ResourceId allocate(const Resource& resource)
+    {
+        GpuMemory::ResourceId id;
+        if (!s_freeIds.empty())
+        {
+            id = s_freeIds.back();
+            s_freeIds.pop_back();
+            s_resources[id - 1] = resource;
+        }
+        else
+        {
+            s_resources.push_back(resource);
+            id = static_cast<GpuMemory::ResourceId>(s_resources.size());
+        }
+        s_categoryBytes[resource.category] += resource.bytes;
+        return id;
+    }
+
+    void setBytes(Resource& resource, size_t bytes)
+    {
+        s_categoryBytes[resource.category] -= resource.bytes;
+        resource.bytes = bytes;
+        s_categoryBytes[resource.category] += bytes;
+    }
+
+    // Формат передачи и байты на тексель для внутреннего формата текстуры (0 - формат не поддерживается)
+    unsigned int texelBytes(GLint internalFormat, GLenum* format = nullptr)
+    {
+        GLenum transfer = GL_NONE;
+        unsigned int bytes = 0;
+        switch (internalFormat)
+        {
+        case GL_RED: case GL_R8:    transfer = GL_RED;  bytes = 1; break;
+        case GL_RG: case GL_RG8:    transfer = GL_RG;   bytes = 2; break;
+        case GL_RGB: case GL_RGB8:  transfer = GL_RGB;  bytes = 3; break;
+        case GL_RGBA: case GL_RGBA8: transfer = GL_RGBA; bytes = 4; break;
+        // Остальные форматы (вложения кадровых буферов) только учитываются; драйверы выравнивают тексель до 4 байт
+        default:                    bytes = 4; break;
+        }
+        if (format != nullptr)
+            *format = transfer;
+        return bytes;
+    }
+
+    // Размер текстуры по всем определенным уровням. Текстура должна быть привязана к GL_TEXTURE_2D
+    size_t boundTextureBytes(GLint* levelCount = nullptr)
+    {
+        GLint maxLevel = 0;
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+        size_t bytes = 0;
+        GLint level = 0;
+        for (; level <= maxLevel; level++)
+        {
+            GLint width = 0, height = 0, internalFormat = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+            if (width == 0 || height == 0)
+                break;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            bytes += static_cast<size_t>(width) * static_cast<size_t>(height) * texelBytes(internalFormat);
+        }
+        if (levelCount != nullptr)
+            *levelCount = level;
+        return bytes;
+    }
+
+    size_t textureBytes(GLuint texture)
+    {
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        size_t bytes = boundTextureBytes();
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous));
+        return bytes;
+    }
+
+    // Копируем уровень sourceLevel текстуры source в уровень targetLevel текстуры target (размеры совпадают) на GPU.
+    // Кадровые буферы чтения и записи должны быть привязаны
+    void blitLevel(GLuint source, GLint sourceLevel, GLuint target, GLint targetLevel, GLint width, GLint height)
+    {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, source, sourceLevel);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, targetLevel);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    // Сдвигаем мипмап текстуры на уровень вниз: уровень l + 1 становится уровнем l, последний освобождается.
+    // Уровни копируются на GPU через временную текстуру, без чтения в память процесса, поэтому конвейер не ждет.
+    // Имя текстуры не меняется, поэтому привязки материалов остаются действительными
+    void dropTopLevel(Resource& resource)
+    {
+        GLint previousTexture = 0, previousRead = 0, previousDraw = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousRead);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDraw);
+        glBindTexture(GL_TEXTURE_2D, resource.name);
+
+        GLint levelCount = 0;
+        boundTextureBytes(&levelCount);
+        GLint internalFormat = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        GLenum format = GL_NONE;
+        texelBytes(internalFormat, &format);
+
+        // Без мипмапа или в незнакомом формате уменьшать нечего: больше текстуру не трогаем
+        if (levelCount < 2 || format == GL_NONE)
+        {
+            resource.evictable = false;
+            glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previousTexture));
+            return;
+        }
+
+        std::vector<GLint> widths(levelCount), heights(levelCount);
+        for (GLint level = 0; level < levelCount; level++)
+        {
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &widths[level]);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &heights[level]);
+        }
+
+        GLuint framebuffers[2] = {0, 0};
+        glGenFramebuffers(2, framebuffers);
+        GLuint scratch = 0;
+        glGenTextures(1, &scratch);
+        GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+        // Уровни 1..n-1 - во временную текстуру уровнями 0..n-2
+        glBindTexture(GL_TEXTURE_2D, scratch);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 2);
+        for (GLint level = 1; level < levelCount; level++)
+            glTexImage2D(GL_TEXTURE_2D, level - 1, internalFormat, widths[level], heights[level], 0, format, GL_UNSIGNED_BYTE, nullptr);
+
+        // Формат, в который нельзя рисовать, не копируется: такую текстуру больше не трогаем
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resource.name, 1);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scratch, 0);
+        bool copyable = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE
+                     && glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (copyable)
+        {
+            for (GLint level = 1; level < levelCount; level++)
+                blitLevel(resource.name, level, scratch, level - 1, widths[level], heights[level]);
+
+            // Уровни текстуры переопределяются на вдвое меньшие все сразу: в уровень несогласованной цепочки рисовать нельзя.
+            // Прежний последний уровень не нужен новой цепочке: освобождаем его память и исключаем из выборки
+            glBindTexture(GL_TEXTURE_2D, resource.name);
+            for (GLint level = 0; level + 1 < levelCount; level++)
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormat, widths[level + 1], heights[level + 1], 0, format, GL_UNSIGNED_BYTE, nullptr);
+            glTexImage2D(GL_TEXTURE_2D, levelCount - 1, internalFormat, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 2);
+
+            // И обратно из временной текстуры
+            for (GLint level = 0; level + 1 < levelCount; level++)
+                blitLevel(scratch, level, resource.name, level, widths[level + 1], heights[level + 1]);
+            setBytes(resource, boundTextureBytes());
+        }
+        else
+        {
+            resource.evictable = false;
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousRead));
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(previousDraw));
+        if (scissor)
+            glEnable(GL_SCISSOR_TEST);
+        glDeleteFramebuffers(2, framebuffers);
+        glDeleteTextures(1, &scratch);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previousTexture));
+    }
+
+    // Текстура, которой можно вернуть отброшенные уровни: из использованных в этом кадре - самая крупная,
+    // полный размер которой укладывается в бюджет с запасом (иначе она сразу потеряла бы уровень снова)
+    Resource* restoreCandidate(size_t limit)
+    {
+        Resource* candidate = nullptr;
+        const size_t used = GpuMemory::used();
+        for (Resource& resource : s_resources)
+        {
+            if (!resource.live || !resource.texture)
+                continue;
+            // Одно восстановление за раз: владелец еще перезагружает текстуру
+            if (resource.restoreRequested)
+                return nullptr;
+            if (resource.bytes >= resource.fullBytes || resource.lastUsed != s_frame)
+                continue;
+            if (limit != 0 && used - resource.bytes + resource.fullBytes > limit - limit / 8)
+                continue;
+            if (candidate == nullptr || resource.fullBytes - resource.bytes > candidate->fullBytes - candidate->bytes)
+                candidate = &resource;
+        }
+        return candidate;
+    }
+
+    void evictBuffer(Resource& resource)
+    {
+        // GL_COPY_WRITE_BUFFER не входит в состояние VAO, поэтому привязки мешей не меняются
+        glBindBuffer(GL_COPY_WRITE_BUFFER, resource.name);
+        glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        resource.evicted = true;
+        setBytes(resource, 0);
+    }
+
+    double megabytes(size_t bytes)
+    {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+
+
+GpuMemory::ResourceId GpuMemory::trackBuffer(GLuint buffer, GpuMemoryCategory category, size_t bytes, bool evictable)
+{
+    Resource resource;
+    resource.name = buffer;
+    resource.category = category;
+    resource.bytes = bytes;
+    resource.lastUsed = s_frame;
+    resource.evictable = evictable;
+    resource.live = true;
+    return allocate(resource);
+}
+
+
+
+GpuMemory::ResourceId GpuMemory::trackTexture(GLuint texture, GpuMemoryCategory category, bool evictable)
+{
+    Resource resource;
+    resource.name = texture;
+    resource.category = category;
+    resource.bytes = textureBytes(texture);
+    resource.fullBytes = resource.bytes;
+    resource.lastUsed = s_frame;
+    resource.texture = true;
+    resource.evictable = evictable;
+    resource.live = true;
+    return allocate(resource);
+}
+
+
+
+void GpuMemory::resize(ResourceId id, size_t bytes)
+{
+    Resource* resource = find(id);
+    if (resource == nullptr)
+        return;
+    resource->evicted = false;
+    setBytes(*resource, bytes);
+}
+
+
+
+void GpuMemory::refresh(ResourceId id)
+{
+    Resource* resource = find(id);
+    if (resource == nullptr || !resource->texture)
+        return;
+    setBytes(*resource, textureBytes(resource->name));
+    resource->fullBytes = resource->bytes;
+    resource->restoreRequested = false;
+}
+
+
+
+void GpuMemory::release(ResourceId id)
+{
+    Resource* resource = find(id);
+    if (resource == nullptr)
+        return;
+    setBytes(*resource, 0);
+    resource->live = false;
+    s_freeIds.push_back(id);
+}
+
+
+
+bool GpuMemory::use(ResourceId id)
+{
+    Resource* resource = find(id);
+    if (resource == nullptr)
+        return true;
+    resource->lastUsed = s_frame;
+    return !resource->evicted;
+}
+
+
+
+bool GpuMemory::restoreRequested(ResourceId id)
+{
+    Resource* resource = find(id);
+    return resource != nullptr && resource->restoreRequested;
+}
+
+
+
+void GpuMemory::endFrame()
+{
+    const size_t limit = s_budget.load(std::memory_order_relaxed);
+    if (limit != 0 && used() > limit)
+    {
+        PROFILE_ZONE("GpuMemory::evict");
+
+        // Кандидаты - от самых давно использованных к недавним, среди одновременно использованных - крупные первыми.
+        // Буфер, нужный в этом кадре, пришлось бы сразу загрузить заново, а уменьшенная текстура рисуется как есть,
+        // поэтому если рабочий набор кадра не укладывается в бюджет, уменьшаются и видимые текстуры
+        std::vector<Resource*> candidates;
+        for (Resource& resource : s_resources)
+            if (resource.live && resource.evictable && !resource.evicted && resource.bytes > 0
+                && (resource.texture || resource.lastUsed < s_frame))
+                candidates.push_back(&resource);
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Resource* a, const Resource* b) {
+            return a->lastUsed != b->lastUsed ? a->lastUsed < b->lastUsed : a->bytes > b->bytes;
+        });
+
+        // Текстура теряет не больше одного уровня за кадр: к следующему кадру картина использования может измениться
+        for (Resource* resource : candidates)
+        {
+            if (used() <= limit)
+                break;
+            if (resource->texture)
+                dropTopLevel(*resource);
+            else
+                evictBuffer(*resource);
+        }
+    }
+    else if (Resource* resource = restoreCandidate(limit))
+    {
+        // Память снова есть: владелец текстуры загрузит ее заново в полном размере (см. restoreRequested)
+        resource->restoreRequested = true;
+    }
+    s_frame++;
+}
+
+
+
+void GpuMemory::setBudget(size_t bytes)
+{
+    s_budget.store(bytes, std::memory_order_relaxed);
+}
+
+
+
+size_t GpuMemory::budget()
+{
+    return s_budget.load(std::memory_order_relaxed);
+}
+
+
+
+size_t GpuMemory::used()
+{
+    size_t total = 0;
+    for (size_t bytes : s_categoryBytes)
+        total += bytes;
+    return total;
+}
+
+
+
+size_t GpuMemory::used(GpuMemoryCategory category)
+{
+    return s_categoryBytes[category];
+}
+
+
+
+GpuMemory::DriverInfo GpuMemory::queryDriver()
+{
+    DriverInfo info;
+    // Оба расширения сообщают память в килобайтах
+    if (GLExtensions::has("GL_NVX_gpu_memory_info"))
+    {
+        GLint totalKb = 0, freeKb = 0;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKb);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &freeKb);
+        info.available = true;
+        info.totalBytes = static_cast<size_t>(totalKb) * 1024;
+        info.freeBytes = static_cast<size_t>(freeKb) * 1024;
+        info.source = "GL_NVX_gpu_memory_info";
+    }
+    else if (GLExtensions::has("GL_ATI_meminfo"))
+    {
+        // Четыре значения: всего свободно, наибольший свободный блок, то же для вспомогательной памяти
+        GLint textureFree[4] = {};
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, textureFree);
+        info.available = true;
+        info.freeBytes = static_cast<size_t>(textureFree[0]) * 1024;
+        info.source = "GL_ATI_meminfo";
+    }
+    return info;
+}
+
+
+
+void GpuMemory::report(std::ostream& out)
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+
+    out << "GPU memory: " << megabytes(used()) << " MB tracked";
+    if (budget() != 0)
+        out << " (budget " << megabytes(budget()) << " MB)";
+    DriverInfo driver = queryDriver();
+    if (driver.available)
+    {
+        out << ", driver " << megabytes(driver.freeBytes) << " MB free";
+        if (driver.totalBytes != 0)
+            out << " of " << megabytes(driver.totalBytes) << " MB";
+        out << " (" << driver.source << ")";
+    }
+    out << std::endl;
+
+    for (unsigned int category = 0; category < GPU_MEMORY_CATEGORY_COUNT; category++)
+        out << "  " << std::left << std::setw(10) << CATEGORY_NAMES[category] << std::right
+            << std::setw(8) << megabytes(s_categoryBytes[category]) << " MB" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,93 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <ostream>
+
+// Назначение видеопамяти в отчете
+enum GpuMemoryCategory : unsigned int
+{
+    GPU_MEMORY_VERTICES = 0,    // Вершинные буферы мешей
+    GPU_MEMORY_INDICES,         // Индексные буферы мешей
+    GPU_MEMORY_INSTANCES,       // Буферы экземпляров, перезаписываемые каждый кадр
+    GPU_MEMORY_TEXTURES,        // Текстуры материалов
+    GPU_MEMORY_RENDER_TARGETS,  // Вложения кадровых буферов
+
+    GPU_MEMORY_CATEGORY_COUNT
+};
+
+// Учет видеопамяти: сколько байт занимают отслеживаемые буферы и текстуры (по категориям) и сколько свободно
+// по данным драйвера (GL_NVX_gpu_memory_info / GL_ATI_meminfo, если есть). При заданном бюджете в конце кадра
+// вытесняются давно не использованные ресурсы: текстуры теряют верхний уровень мипмапа (вдвое меньше по каждой оси),
+// буферы, содержимое которых владелец умеет восстановить, освобождаются до следующего использования. Когда бюджет
+// снова позволяет, владельца уменьшенной текстуры просят загрузить ее заново (restoreRequested).
+// Все функции, кроме setBudget, вызываются только из потока, в котором текущим является GL-контекст.
+namespace GpuMemory
+{
+    using ResourceId = unsigned int;
+    const ResourceId NO_RESOURCE = 0;
+
+    /**
+     * @brief trackBuffer - Начинаем учет буфера.
+     * @param evictable - Владелец умеет заново заполнить буфер (см. use), поэтому его можно вытеснить.
+     */
+    ResourceId trackBuffer(GLuint buffer, GpuMemoryCategory category, size_t bytes, bool evictable = false);
+
+    /**
+     * @brief trackTexture - Начинаем учет двумерной текстуры; размер считается по всем ее уровням.
+     * @param evictable - Можно ли при нехватке бюджета отбрасывать верхние уровни мипмапа. Владелец такой текстуры
+     * должен уметь загрузить ее заново (см. restoreRequested).
+     */
+    ResourceId trackTexture(GLuint texture, GpuMemoryCategory category, bool evictable = false);
+
+    // Буфер перевыделен с новым размером
+    void resize(ResourceId id, size_t bytes);
+
+    // Хранилище текстуры пересоздано: пересчитываем ее размер (он же теперь полный)
+    void refresh(ResourceId id);
+
+    // GL-объект удален владельцем
+    void release(ResourceId id);
+
+    /**
+     * @brief use - Отмечаем использование ресурса в текущем кадре.
+     * @return false, если буфер был вытеснен: владелец заполняет его заново и сообщает новый размер через resize.
+     */
+    bool use(ResourceId id);
+
+    /**
+     * @brief restoreRequested - У текстуры отброшены уровни, а в бюджете снова есть место для полного размера.
+     * Владелец загружает ее заново в то же имя и вызывает refresh; до этого другим текстурам уровни не возвращаются.
+     */
+    bool restoreRequested(ResourceId id);
+
+    /**
+     * @brief endFrame - Завершаем кадр. Если отслеживаемые ресурсы не укладываются в бюджет, вытесняем ресурсы,
+     * не использованные в этом кадре, начиная с самых давних.
+     */
+    void endFrame();
+
+    // Бюджет в байтах, 0 - без ограничения. Можно задать до запуска потока рендеринга
+    void setBudget(size_t bytes);
+    size_t budget();
+
+    size_t used();
+    size_t used(GpuMemoryCategory category);
+
+    // Видеопамять по данным драйвера
+    struct DriverInfo
+    {
+        bool        available = false;
+        size_t      totalBytes = 0;     // 0 - драйвер не сообщает (GL_ATI_meminfo)
+        size_t      freeBytes = 0;
+        const char* source = "";        // Расширение, из которого взяты данные
+    };
+    DriverInfo queryDriver();
+
+    // Печатаем отслеживаемую память по категориям, бюджет и данные драйвера
+    void report(std::ostream& out);
+}
+
+#endif // GPU_MEMORY_H
@@ -0,0 +1,262 @@
+#include "gpuprofiler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+GpuProfiler::GpuProfiler()
+{
+    for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+    {
+        glGenQueries(2 * MAX_SCOPES_PER_FRAME, m_queries[i]);
+        m_frames[i].scopes.reserve(MAX_SCOPES_PER_FRAME);
+        m_frames[i].openScopes.reserve(MAX_SCOPES_PER_FRAME);
+    }
+}
+
+
+
+GpuProfiler::~GpuProfiler()
+{
+    for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+        glDeleteQueries(2 * MAX_SCOPES_PER_FRAME, m_queries[i]);
+}
+
+
+
+void GpuProfiler::beginFrame()
+{
+    m_currentSlot = static_cast<unsigned int>(m_frameCounter % FRAME_LATENCY);
+    FrameSlot& slot = m_frames[m_currentSlot];
+
+    // Кольцо вернулось к этому кадру: его запросы были отправлены FRAME_LATENCY кадров назад
+    collect(slot, m_currentSlot);
+
+    slot.scopes.clear();
+    slot.openScopes.clear();
+    slot.usedQueries = 0;
+    slot.pending = true;
+
+    beginScope("frame");
+}
+
+
+
+void GpuProfiler::endFrame()
+{
+    FrameSlot& slot = m_frames[m_currentSlot];
+    while (!slot.openScopes.empty())
+        endScope();
+    m_frameCounter++;
+}
+
+
+
+void GpuProfiler::beginScope(const char* name)
+{
+    FrameSlot& slot = m_frames[m_currentSlot];
+    if (!slot.pending || slot.usedQueries + 2 > 2 * MAX_SCOPES_PER_FRAME)
+    {
+        // Запросы кадра закончились: проход не измеряется, но вложенность сохраняем
+        slot.openScopes.push_back(UINT_MAX);
+        return;
+    }
+
+    ScopeRecord record;
+    record.name = name;
+    record.depth = static_cast<unsigned int>(slot.openScopes.size());
+    record.beginQuery = slot.usedQueries++;
+    record.endQuery = slot.usedQueries++;
+    glQueryCounter(m_queries[m_currentSlot][record.beginQuery], GL_TIMESTAMP);
+
+    slot.openScopes.push_back(static_cast<unsigned int>(slot.scopes.size()));
+    slot.scopes.push_back(record);
+}
+
+
+
+void GpuProfiler::endScope()
+{
+    FrameSlot& slot = m_frames[m_currentSlot];
+    if (slot.openScopes.empty())
+        return;
+
+    unsigned int index = slot.openScopes.back();
+    slot.openScopes.pop_back();
+    if (index == UINT_MAX)
+        return;
+
+    glQueryCounter(m_queries[m_currentSlot][slot.scopes[index].endQuery], GL_TIMESTAMP);
+}
+
+
+
+void GpuProfiler::collect(FrameSlot& slot, unsigned int slotIndex)
+{
+    if (!slot.pending)
+        return;
+    slot.pending = false;
+
+    // Проверяем готовность без ожидания. Если GPU отстал больше чем на FRAME_LATENCY кадров, кадр пропускаем
+    for (unsigned int i = 0; i < slot.usedQueries; i++)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[slotIndex][i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            m_droppedFrames++;
+            return;
+        }
+    }
+
+    for (const ScopeRecord& scope : slot.scopes)
+    {
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(m_queries[slotIndex][scope.beginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(m_queries[slotIndex][scope.endQuery], GL_QUERY_RESULT, &end);
+        if (end < begin)
+            continue;
+
+        double ms = static_cast<double>(end - begin) / 1.0e6;
+        PassStats& stats = statsFor(scope.name);
+        if (stats.samples == 0)
+        {
+            stats.minMs = ms;
+            stats.maxMs = ms;
+            stats.smoothedMs = ms;
+        }
+        stats.samples++;
+        stats.lastMs = ms;
+        stats.totalMs += ms;
+        stats.minMs = std::min(stats.minMs, ms);
+        stats.maxMs = std::max(stats.maxMs, ms);
+        stats.smoothedMs += (ms - stats.smoothedMs) * 0.1;
+
+        if (m_firstTimestamp == 0)
+            m_firstTimestamp = begin;
+        if (m_trace.size() == MAX_TRACE_EVENTS)
+            m_trace.pop_front();
+        m_trace.push_back({scope.name, scope.depth, begin, end - begin});
+    }
+}
+
+
+
+GpuProfiler::PassStats& GpuProfiler::statsFor(const char* name)
+{
+    for (PassStats& stats : m_stats)
+    {
+        if (stats.name == name)
+            return stats;
+    }
+    m_stats.emplace_back();
+    m_stats.back().name = name;
+    return m_stats.back();
+}
+
+
+
+const std::vector<GpuProfiler::PassStats>& GpuProfiler::stats() const
+{
+    return m_stats;
+}
+
+
+
+bool GpuProfiler::exportCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::GPU_PROFILER::CAN'T WRITE FILE " << path << std::endl;
+        return false;
+    }
+
+    file << "pass,samples,avg_ms,min_ms,max_ms,last_ms\n";
+    for (const PassStats& stats : m_stats)
+    {
+        file << stats.name << ',' << stats.samples << ',' << stats.averageMs() << ','
+             << stats.minMs << ',' << stats.maxMs << ',' << stats.lastMs << '\n';
+    }
+    file << "# dropped_frames," << m_droppedFrames << '\n';
+    return true;
+}
+
+
+
+bool GpuProfiler::exportChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::GPU_PROFILER::CAN'T WRITE FILE " << path << std::endl;
+        return false;
+    }
+
+    // Время в trace_event задается в микросекундах, отсчет ведем от первого измеренного прохода
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const TraceEvent& event : m_trace)
+    {
+        if (!first)
+            file << ",\n";
+        first = false;
+        file << "{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":\"GPU\""
+             << ",\"ts\":" << static_cast<double>(event.beginNs - m_firstTimestamp) / 1000.0
+             << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0
+             << ",\"args\":{\"depth\":" << event.depth << "}}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
+
+
+
+void GpuProfiler::drawOverlay(int framebufferWidth, int framebufferHeight) const
+{
+    const int barHeight = 6;
+    const int spacing = 2;
+    const int margin = 8;
+    const int maxWidth = std::max(framebufferWidth / 3, 1);
+
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glEnable(GL_SCISSOR_TEST);
+
+    int y = framebufferHeight - margin - barHeight;
+    for (const PassStats& stats : m_stats)
+    {
+        if (y < 0)
+            break;
+
+        // Фон полосы - бюджет кадра OVERLAY_BUDGET_MS
+        glScissor(margin, y, maxWidth, barHeight);
+        glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Цвет прохода зависит только от его имени, чтобы он не менялся между кадрами
+        unsigned int hash = 2166136261u;
+        for (char c : stats.name)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        float r = 0.4f + 0.6f * static_cast<float>(hash & 0xFF) / 255.0f;
+        float g = 0.4f + 0.6f * static_cast<float>((hash >> 8) & 0xFF) / 255.0f;
+        float b = 0.4f + 0.6f * static_cast<float>((hash >> 16) & 0xFF) / 255.0f;
+
+        double fraction = std::min(stats.smoothedMs / OVERLAY_BUDGET_MS, 1.0);
+        int width = static_cast<int>(fraction * maxWidth);
+        if (width > 0)
+        {
+            glScissor(margin, y, width, barHeight);
+            glClearColor(r, g, b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+
+        y -= barHeight + spacing;
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
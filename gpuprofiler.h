@@ -0,0 +1,132 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+ * @brief GpuProfiler - Измеряет время выполнения именованных проходов рендеринга на GPU.
+ * Начало и конец каждого прохода отмечаются запросами glQueryCounter(GL_TIMESTAMP). Запросы
+ * распределены по кольцу из FRAME_LATENCY кадров, и результаты кадра читаются только тогда, когда
+ * кольцо возвращается к нему, поэтому чтение никогда не останавливает конвейер.
+ * Все методы вызываются только из потока, в котором текущим является GL-контекст.
+ */
+class GpuProfiler
+{
+public:
+    static const unsigned int FRAME_LATENCY = 4;            // Количество кадров в кольце запросов
+    static const unsigned int MAX_SCOPES_PER_FRAME = 64;    // Максимум проходов за кадр
+
+    // Накопленная статистика одного прохода
+    struct PassStats
+    {
+        std::string         name;
+        unsigned long long  samples = 0;
+        double              lastMs = 0.0;
+        double              smoothedMs = 0.0;   // экспоненциальное скользящее среднее
+        double              minMs = 0.0;
+        double              maxMs = 0.0;
+        double              totalMs = 0.0;
+
+        double averageMs() const { return samples ? totalMs / static_cast<double>(samples) : 0.0; }
+    };
+
+    // RAII-обертка для прохода: beginScope в конструкторе, endScope в деструкторе
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, const char* name) : m_profiler(profiler) { m_profiler.beginScope(name); }
+        ~Scope() { m_profiler.endScope(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        GpuProfiler& m_profiler;
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    /**
+     * @brief beginFrame - Забираем готовые результаты самого старого кадра кольца и открываем проход "frame".
+     */
+    void beginFrame();
+
+    /**
+     * @brief endFrame - Закрываем проход "frame".
+     */
+    void endFrame();
+
+    /**
+     * @brief beginScope - Открываем именованный проход. Проходы могут быть вложенными.
+     * @param name - Имя прохода (строка должна жить до конца работы профайлера, например литерал).
+     */
+    void beginScope(const char* name);
+    void endScope();
+
+    const std::vector<PassStats>& stats() const;
+
+    /**
+     * @brief exportCsv - Сохраняем накопленную статистику по проходам в CSV.
+     */
+    bool exportCsv(const std::string& path) const;
+
+    /**
+     * @brief exportChromeTrace - Сохраняем историю проходов в формате Chrome trace_event (chrome://tracing).
+     */
+    bool exportChromeTrace(const std::string& path) const;
+
+    /**
+     * @brief drawOverlay - Рисуем поверх кадра полосы времени проходов (без шейдеров, через scissor + glClear).
+     * Полная ширина полосы соответствует OVERLAY_BUDGET_MS.
+     */
+    void drawOverlay(int framebufferWidth, int framebufferHeight) const;
+
+private:
+    struct ScopeRecord
+    {
+        const char*     name;
+        unsigned int    depth;
+        unsigned int    beginQuery;
+        unsigned int    endQuery;
+    };
+
+    struct FrameSlot
+    {
+        std::vector<ScopeRecord>    scopes;
+        std::vector<unsigned int>   openScopes;
+        unsigned int                usedQueries = 0;
+        bool                        pending = false;
+    };
+
+    struct TraceEvent
+    {
+        const char*         name;
+        unsigned int        depth;
+        unsigned long long  beginNs;
+        unsigned long long  durationNs;
+    };
+
+    void collect(FrameSlot& slot, unsigned int slotIndex);
+    PassStats& statsFor(const char* name);
+
+private:
+    static const size_t MAX_TRACE_EVENTS = 65536;
+    static constexpr double OVERLAY_BUDGET_MS = 1000.0 / 60.0;
+
+    GLuint                  m_queries[FRAME_LATENCY][2 * MAX_SCOPES_PER_FRAME];
+    FrameSlot               m_frames[FRAME_LATENCY];
+    unsigned int            m_currentSlot = 0;
+    unsigned long long      m_frameCounter = 0;
+    unsigned long long      m_droppedFrames = 0;
+    unsigned long long      m_firstTimestamp = 0;
+
+    std::vector<PassStats>  m_stats;
+    std::deque<TraceEvent>  m_trace;
+};
+
+#endif // GPU_PROFILER_H
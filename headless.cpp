@@ -0,0 +1,325 @@
+#include "headless.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#ifdef ONION_HEADLESS
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+#include "STB/stb_image.h"
+#include "glextensions.h"
+#include "glresource.h"
+#include "renderer.h"
+#include "glresource.h"
+#include "gpumemory.h"
+
+namespace
+{
+    // Все ресурсы EGL, созданные для безоконного контекста
+    struct HeadlessContext
+    {
+        EGLDisplay  display = EGL_NO_DISPLAY;
+        EGLContext  context = EGL_NO_CONTEXT;
+        EGLSurface  surface = EGL_NO_SURFACE;
+    };
+
+    bool hasExtension(const char* extensions, const char* name)
+    {
+        if (extensions == nullptr)
+            return false;
+        size_t length = std::strlen(name);
+        for (const char* p = std::strstr(extensions, name); p != nullptr; p = std::strstr(p + length, name))
+        {
+            bool startOk = (p == extensions) || (p[-1] == ' ');
+            bool endOk = (p[length] == ' ') || (p[length] == '\0');
+            if (startOk && endOk)
+                return true;
+        }
+        return false;
+    }
+
+    bool createContext(HeadlessContext& ctx)
+    {
+        // Предпочитаем платформу surfaceless от Mesa: ей не нужен ни X11, ни DRM-устройство
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        {
+            auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+            if (getPlatformDisplay != nullptr)
+                ctx.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (ctx.display == EGL_NO_DISPLAY)
+            ctx.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint major = 0;
+        EGLint minor = 0;
+        if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, &major, &minor))
+        {
+            std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+            return false;
+        }
+
+        const char* displayExtensions = eglQueryString(ctx.display, EGL_EXTENSIONS);
+        bool surfaceless = hasExtension(displayExtensions, "EGL_KHR_surfaceless_context");
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config = nullptr;
+        EGLint numConfigs = 0;
+        if (!eglBindAPI(EGL_OPENGL_API) ||
+            !eglChooseConfig(ctx.display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+        {
+            std::cout << "ERROR::HEADLESS::EGL_NO_SUITABLE_CONFIG" << std::endl;
+            return false;
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+            EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_NONE
+        };
+        ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (ctx.context == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::HEADLESS::EGL_CREATE_CONTEXT_FAILED (GL 3.3 core)" << std::endl;
+            return false;
+        }
+
+        // Рисуем только в FBO, поэтому поверхность нужна лишь там, где нет surfaceless-контекстов
+        if (!surfaceless)
+        {
+            const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            ctx.surface = eglCreatePbufferSurface(ctx.display, config, pbufferAttributes);
+            if (ctx.surface == EGL_NO_SURFACE)
+            {
+                std::cout << "ERROR::HEADLESS::EGL_CREATE_PBUFFER_FAILED" << std::endl;
+                return false;
+            }
+        }
+
+        if (!eglMakeCurrent(ctx.display, ctx.surface, ctx.surface, ctx.context))
+        {
+            std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT_FAILED" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void destroyContext(HeadlessContext& ctx)
+    {
+        if (ctx.display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (ctx.surface != EGL_NO_SURFACE)
+            eglDestroySurface(ctx.display, ctx.surface);
+        if (ctx.context != EGL_NO_CONTEXT)
+            eglDestroyContext(ctx.display, ctx.context);
+        eglTerminate(ctx.display);
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    void printTimings(const char* label, std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        std::cout << std::left << std::setw(10) << label << std::right << std::fixed << std::setprecision(3)
+                  << " p50 " << std::setw(8) << percentile(samples, 50.0)
+                  << "  p90 " << std::setw(8) << percentile(samples, 90.0)
+                  << "  p99 " << std::setw(8) << percentile(samples, 99.0)
+                  << "  max " << std::setw(8) << (samples.empty() ? 0.0 : samples.back()) << " ms" << std::endl;
+    }
+
+    // Результаты одного прогона сцены
+    struct RunTimings
+    {
+        std::vector<double> submitMs;
+        std::vector<double> frameMs;
+        double              seconds = 0.0;
+    };
+
+    // Прогреваем и измеряем options.frames кадров. adjust вызывается после подготовки каждого снимка
+    RunTimings runFrames(Renderer& renderer, const HeadlessOptions& options, const FrameStateBuilder& buildFrameState,
+                         const std::function<void(FrameState&)>& adjust)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        RunTimings timings;
+        timings.submitMs.reserve(static_cast<size_t>(options.frames));
+        timings.frameMs.reserve(static_cast<size_t>(options.frames));
+
+        FrameState state;
+        auto runStart = Clock::now();
+        for (int i = 0; i < options.warmupFrames + options.frames; i++)
+        {
+            if (i == options.warmupFrames)
+                runStart = Clock::now();
+
+            buildFrameState(state, static_cast<double>(i) * options.timeStep);
+            state.framebufferWidth = options.width;
+            state.framebufferHeight = options.height;
+            if (adjust)
+                adjust(state);
+
+            // "submit" - работа CPU на формирование команд, "frame" - вместе с ожиданием выполнения кадра
+            auto frameStart = Clock::now();
+            renderer.Draw(state);
+            auto submitEnd = Clock::now();
+            glFinish();
+            auto frameEnd = Clock::now();
+
+            if (i >= options.warmupFrames)
+            {
+                timings.submitMs.push_back(std::chrono::duration<double, std::milli>(submitEnd - frameStart).count());
+                timings.frameMs.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+            }
+        }
+        timings.seconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+        return timings;
+    }
+
+    // Прямое и отложенное освещение для растущего числа точечных источников
+    void runLightingSweep(Renderer& renderer, const HeadlessOptions& options, const FrameStateBuilder& buildFrameState)
+    {
+        const unsigned int lightCounts[] = { 0, 16, 64, 128, MAX_POINT_LIGHTS };
+
+        std::cout << "Lighting sweep: " << options.frames << " frames per run, frame time p50 / p90, ms" << std::endl;
+        std::cout << std::setw(8) << "lights" << std::setw(22) << "forward" << std::setw(22) << "deferred" << std::endl;
+        for (unsigned int lights : lightCounts)
+        {
+            std::cout << std::setw(8) << lights;
+            for (RenderPath path : { RenderPath::Forward, RenderPath::Deferred })
+            {
+                RunTimings timings = runFrames(renderer, options, buildFrameState, [lights, path](FrameState& state) {
+                    state.pointLightCount = lights;
+                    state.renderPath = path;
+                });
+                std::sort(timings.frameMs.begin(), timings.frameMs.end());
+                std::cout << std::fixed << std::setprecision(3) << std::setw(12) << percentile(timings.frameMs, 50.0)
+                          << " / " << std::setw(7) << percentile(timings.frameMs, 90.0);
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+
+
+int runHeadlessBenchmark(const HeadlessOptions& options, const FrameStateBuilder& buildFrameState, ThreadPool& workers)
+{
+    HeadlessContext ctx;
+    if (!createContext(ctx))
+    {
+        destroyContext(ctx);
+        return -1;
+    }
+
+    // glad: загрузка всех указателей на OpenGL-функции
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        destroyContext(ctx);
+        return -1;
+    }
+    GLExtensions::load(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+    std::cout << "GL_RENDERER: " << glGetString(GL_RENDERER) << "\nGL_VERSION:  " << glGetString(GL_VERSION) << std::endl;
+
+    // Внеэкранный кадровый буфер: цвет + глубина
+    FramebufferHandle fbo = FramebufferHandle::create();
+    RenderbufferHandle color = RenderbufferHandle::create();
+    RenderbufferHandle depth = RenderbufferHandle::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, options.width, options.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, options.width, options.height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+    int result = 0;
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        result = -1;
+    }
+    else
+    {
+        // Сообщаем stb_image.h, чтобы он перевернул загруженные текстуры относительно y-оси (до загрузки модели)
+        stbi_set_flip_vertically_on_load(true);
+        glEnable(GL_DEPTH_TEST);
+
+        using Clock = std::chrono::steady_clock;
+        auto loadStart = Clock::now();
+        Renderer renderer(workers);
+        // Замер включает фоновый импорт моделей, а кадры рисуются уже без заглушек
+        renderer.waitForModels();
+        glFinish();
+        double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - loadStart).count();
+        std::cout << "Scene load: " << std::fixed << std::setprecision(1) << loadMs << " ms" << std::endl;
+
+        if (options.lightingSweep)
+        {
+            runLightingSweep(renderer, options, buildFrameState);
+        }
+        else
+        {
+            RunTimings timings = runFrames(renderer, options, buildFrameState, nullptr);
+            std::cout << "Frames: " << options.frames << " at " << options.width << "x" << options.height
+                      << ", " << std::setprecision(1) << (timings.seconds > 0.0 ? options.frames / timings.seconds : 0.0)
+                      << " FPS" << std::endl;
+            printTimings("submit", timings.submitMs);
+            printTimings("frame", timings.frameMs);
+        }
+
+        for (const GpuProfiler::PassStats& stats : renderer.gpuProfiler().stats())
+        {
+            std::cout << "GPU " << std::left << std::setw(8) << stats.name << std::right << std::setprecision(3)
+                      << " avg " << std::setw(8) << stats.averageMs()
+                      << "  max " << std::setw(8) << stats.maxMs << " ms" << std::endl;
+        }
+        GpuMemory::report(std::cout);
+    }
+
+    // Кадровый буфер уходит в очередь удаления вместе с остальными объектами; очередь опустошаем, пока контекст жив
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    fbo.reset();
+    color.reset();
+    depth.reset();
+    GLDeletionQueue::flush();
+    destroyContext(ctx);
+    return result;
+}
+
+#else
+
+int runHeadlessBenchmark(const HeadlessOptions& options, const FrameStateBuilder& buildFrameState, ThreadPool& workers)
+{
+    (void)options;
+    (void)buildFrameState;
+    (void)workers;
+    std::cout << "ERROR::HEADLESS::NOT_SUPPORTED (build with EGL, ONION_HEADLESS)" << std::endl;
+    return -1;
+}
+
+#endif // ONION_HEADLESS
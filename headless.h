@@ -0,0 +1,35 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "FrameState.hpp"
+#include "threadpool.h"
+
+#include <functional>
+
+// Параметры безоконного замера производительности
+struct HeadlessOptions
+{
+    int frames = 1000;          // Количество измеряемых кадров
+    int warmupFrames = 30;      // Кадры прогрева, не попадающие в статистику
+    int width = 800;            // Размеры внеэкранного кадрового буфера
+    int height = 600;
+    double timeStep = 1.0 / 60.0; // Шаг времени сцены между кадрами
+    bool lightingSweep = false; // Сравнить прямое и отложенное освещение при растущем числе источников
+};
+
+// Заполняет снимок сцены для момента времени time (в секундах)
+using FrameStateBuilder = std::function<void(FrameState& state, double time)>;
+
+/**
+ * @brief runHeadlessBenchmark - Создаем GL 3.3 core контекст через EGL без окна (surfaceless или pbuffer,
+ * работает в том числе на Mesa llvmpipe), рисуем сцену в FBO заданное число кадров и печатаем
+ * пропускную способность и перцентили времени кадра. С lightingSweep сцена прогоняется для каждого числа
+ * точечных источников обоими способами освещения, и печатается таблица времени кадра.
+ * @param options - Параметры замера.
+ * @param buildFrameState - Функция, подготавливающая снимок сцены для каждого кадра.
+ * @param workers - Общий пул рабочих потоков для рендерера.
+ * @return - Код возврата процесса (0 при успехе).
+ */
+int runHeadlessBenchmark(const HeadlessOptions& options, const FrameStateBuilder& buildFrameState, ThreadPool& workers);
+
+#endif // HEADLESS_H
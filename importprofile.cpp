@@ -0,0 +1,66 @@
+#include "importprofile.h"
+#include "material.h"
+
+
+
+ImportProfile ImportProfile::all()
+{
+    return ImportProfile();
+}
+
+
+
+bool ImportProfile::wants(TextureSlot slot) const
+{
+    return (textures & (1u << slot)) != 0;
+}
+
+
+
+ImportProfile ImportProfile::fromProgram(GLuint program)
+{
+    ImportProfile profile;
+    // Без позиции меш нарисовать нельзя, поэтому она нужна всегда
+    profile.vertexStreams = VERTEX_POSITION;
+    profile.textures = 0;
+
+    GLchar name[256];
+
+    GLint attributeCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    for (GLint i = 0; i < attributeCount; i++)
+    {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(program, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+
+        // Встроенные атрибуты (gl_VertexID) не имеют location, атрибуты экземпляров лежат за потоками вершины
+        GLint location = glGetAttribLocation(program, name);
+        if (location >= 0 && static_cast<unsigned int>(location) < VERTEX_STREAM_COUNT)
+            profile.vertexStreams |= 1u << location;
+    }
+
+    GLint uniformCount = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+        TextureSlot slot;
+        unsigned int index = 0;
+        if (type == GL_SAMPLER_2D && Material::parseSampler(name, slot, index))
+            profile.textures |= 1u << slot;
+    }
+    return profile;
+}
+
+
+
+ImportProfile& ImportProfile::operator|=(const ImportProfile& other)
+{
+    vertexStreams |= other.vertexStreams;
+    textures |= other.textures;
+    keepGeometry = keepGeometry || other.keepGeometry;
+    return *this;
+}
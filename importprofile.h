@@ -0,0 +1,50 @@
+#ifndef IMPORT_PROFILE_H
+#define IMPORT_PROFILE_H
+
+#include <glad/glad.h>
+
+#include "Texture.hpp"
+#include "Vertex.hpp"
+
+// Слоты текстур материала, которые может прочитать шейдер (сэмплеры texture_<слот>N)
+enum ImportTexture : unsigned int
+{
+    IMPORT_TEXTURE_DIFFUSE  = 1u << TEXTURE_SLOT_DIFFUSE,
+    IMPORT_TEXTURE_SPECULAR = 1u << TEXTURE_SLOT_SPECULAR,
+    IMPORT_TEXTURE_NORMAL   = 1u << TEXTURE_SLOT_NORMAL,
+    IMPORT_TEXTURE_HEIGHT   = 1u << TEXTURE_SLOT_HEIGHT,
+
+    IMPORT_TEXTURE_ALL      = (1u << TEXTURE_SLOT_COUNT) - 1
+};
+
+/**
+ * @brief ImportProfile - Что из файла модели действительно нужно шейдеру: потоки вершинных атрибутов (VertexStream)
+ * и типы текстур материала (ImportTexture). Строится по активным атрибутам и сэмплерам связанной программы,
+ * поэтому Model не считает касательные, не хранит неиспользуемые потоки и не декодирует лишние текстуры.
+ */
+struct ImportProfile
+{
+    unsigned int vertexStreams = VERTEX_STREAM_ALL;
+    unsigned int textures = IMPORT_TEXTURE_ALL;
+    // Оставить копию вершин и индексов в памяти процесса (Mesh::cpuVertices), например для пикинга или чтобы
+    // GpuMemory мог вытеснять буферы меша. По умолчанию геометрия есть только в буферах GPU
+    bool keepGeometry = false;
+
+    // Профиль, загружающий все (поведение без рефлексии)
+    static ImportProfile all();
+
+    // Нужна ли текстура указанного слота
+    bool wants(TextureSlot slot) const;
+
+    /**
+     * @brief fromProgram - Профиль по активным атрибутам и сэмплерам связанной программы.
+     * Атрибуты сопоставляются потокам по location, сэмплеры - типам текстур по префиксу имени.
+     * @param program - Идентификатор связанной программы.
+     */
+    static ImportProfile fromProgram(GLuint program);
+
+    // Объединение профилей: модель, которую рисуют несколько программ, загружает то, что нужно любой из них
+    ImportProfile& operator|=(const ImportProfile& other);
+};
+
+#endif // IMPORT_PROFILE_H
@@ -5,13 +5,41 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "renderer.h"
+#include "sceneloader.h"
+#include "glextensions.h"
+#include "FrameState.hpp"
+#include "TripleBuffer.hpp"
+#include "cpuprofiler.h"
+#include "headless.h"
+#include "camerapath.h"
+#include "transformsystem.h"
+#include "transformbenchmark.h"
+#include "orbitalsystem.h"
+#include "orbitbenchmark.h"
+#include "objbenchmark.h"
+#include "glresource.h"
+#include "gpumemory.h"
+#include "assetpack.h"
+#ifdef _WIN32
 #include <windef.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "STB/stb_image.h"
@@ -20,27 +48,142 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
+void stepSimulation(GLFWwindow* window, float step);
+void updateFrameState(FrameState& state, const Camera& viewCamera, double time);
+void updatePointLights(FrameState& state, double time);
+void setupAsteroids();
+ThreadPool& sharedWorkers();
+void renderThreadMain(GLFWwindow* window);
+
+// Параметры запуска из командной строки
+struct LaunchOptions
+{
+    bool            headless = false;   // --headless
+    bool            framesSet = false;  // передан --frames
+    HeadlessOptions headlessOptions;
+    std::string     recordPath;         // --record <file>: записать путь камеры
+    std::string     replayPath;         // --replay <file>: воспроизвести путь камеры
+    size_t          transformBenchmark = 0; // --bench-transforms [N]: замер сборки N матриц без окна
+    size_t          orbitBenchmark = 0;     // --bench-orbits [N]: замер движения N тел без окна
+    std::string     packPath;           // --pack <file>: читать ресурсы из пакета
+    std::string     buildPackPath;      // --build-pack <file>: собрать пакет из каталогов ресурсов и выйти
+    std::string     objBenchmarkPath;   // --bench-obj [file]: замер загрузки OBJ через Assimp и ObjLoader без окна
+};
+
+void parseCommandLine(int argc, char** argv, LaunchOptions& options);
 
 // Константы
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 const unsigned int FRAME_RATE_LOCK = 120;
 const unsigned int FRAME_LOCK_PERIOD = 1000 / FRAME_RATE_LOCK;
+const unsigned int SIMULATION_RATE = 60;
+const double SIMULATION_STEP = 1.0 / SIMULATION_RATE;
+const double MAX_FRAME_TIME = 0.25;    // Паузы длиннее (отладчик, перетаскивание окна) не догоняем шагами симуляции
+const double TWO_PI = 6.283185307179586;
+const float ASTEROID_CENTRAL_GM = 0.3f;     // Период обращения на расстоянии 3 от планеты - около минуты
 
-// Камера
+// Ресурсы лежат в каталогах ASSET_DIRECTORIES внутри ASSET_ROOT; пакет подключается вместо ASSET_ROOT
+const char* const ASSET_ROOT = "../onion";
+const std::vector<std::string> ASSET_DIRECTORIES = { "models", "textures", "shaders" };
+
+// Камера (принадлежит потоку обновления - главному потоку, в котором GLFW доставляет события ввода)
 static Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 static float lastX = SCR_WIDTH / 2.0f;
 static float lastY = SCR_HEIGHT / 2.0f;
 static bool firstMouse = true;
 
-// Тайминги
-static float deltaTime = 0.0;
-static float lastFrame = 0.0;
+// Симуляция идет фиксированными шагами SIMULATION_STEP в двойной точности. Снимок для рендеринга строится
+// между двумя последними шагами: время сцены и позиция камеры интерполируются по остатку накопителя
+static double simulationTime = 0.0;
+static double previousSimulationTime = 0.0;
+static double simulationAccumulator = 0.0;
+static glm::vec3 previousCameraPosition = camera.Position;
+
+// Размеры кадрового буфера, полученные от GLFW (окно просмотра меняет поток рендеринга)
+static int framebufferWidth = SCR_WIDTH;
+static int framebufferHeight = SCR_HEIGHT;
+
+// Запись и воспроизведение пути камеры для повторяемых замеров
+static CameraPathRecorder cameraRecorder;
+static CameraPathPlayer cameraPlayer;
+
+// Отладочный вывод
+static bool showGpuOverlay = false;
+
+// Освещение: способ (F2 переключает прямое/отложенное) и число огней орбитальных станций вокруг планеты
+static RenderPath renderPath = RenderPath::Forward;
+static unsigned int scenePointLights = 64;
 
+// Трансформации объектов сцены
+static TransformSystem sceneTransforms;
+static const TransformSystem::Handle starTransform = sceneTransforms.create();
+static const TransformSystem::Handle planetTransform = sceneTransforms.create();
+static const TransformSystem::Handle skyTransform = sceneTransforms.create();
 
+// Пояс астероидов вокруг планеты: --asteroids N, --nbody включает взаимное притяжение (Барнс-Хат).
+// По умолчанию пояса нет: каждый астероид - экземпляр полного меша планеты, и замеры без него остаются сравнимыми
+static unsigned int sceneAsteroids = 0;
+static OrbitalSystem::Integrator asteroidIntegrator = OrbitalSystem::Integrator::Kepler;
+static OrbitalSystem asteroidOrbits(ASTEROID_CENTRAL_GM);
+static TransformSystem::Handle firstAsteroidTransform = 0;
 
-int main()
+// Обмен снимками сцены между потоком обновления и потоком рендеринга
+static TripleBuffer<FrameState> frameStates;
+static std::atomic<bool> renderRunning(true);
+
+
+
+int main(int argc, char** argv)
 {
+    LaunchOptions launchOptions;
+    parseCommandLine(argc, argv, launchOptions);
+
+    if (launchOptions.transformBenchmark > 0)
+        return runTransformBenchmark(launchOptions.transformBenchmark);
+    if (launchOptions.orbitBenchmark > 0)
+        return runOrbitBenchmark(launchOptions.orbitBenchmark);
+    if (!launchOptions.buildPackPath.empty())
+        return AssetPack::build(ASSET_ROOT, ASSET_DIRECTORIES, launchOptions.buildPackPath) ? 0 : -1;
+    // Одно отображение файла вместо сотен открытий отдельных файлов при загрузке
+    if (!launchOptions.packPath.empty() && !AssetPack::mount(launchOptions.packPath, ASSET_ROOT))
+        return -1;
+    if (!launchOptions.objBenchmarkPath.empty())
+        return runObjBenchmark(launchOptions.objBenchmarkPath);
+
+    // Файлы моделей читаются в фоне, пока создаются окно и GL-контекст и собираются шейдеры
+    Renderer::prefetchModels(sharedWorkers());
+    SceneLoader::ShutdownGuard sceneLoaderShutdown;
+
+    setupAsteroids();
+
+    if (!launchOptions.replayPath.empty() && !cameraPlayer.load(launchOptions.replayPath))
+        return -1;
+    if (!launchOptions.recordPath.empty() && !cameraRecorder.open(launchOptions.recordPath))
+        return -1;
+
+    // Безоконный режим замера производительности: --headless [--frames N] [--size WxH] [--replay file] [--bench-lighting]
+    if (launchOptions.headless)
+    {
+        HeadlessOptions& headlessOptions = launchOptions.headlessOptions;
+        // Проекция камеры берет соотношение сторон внеэкранного кадра
+        framebufferWidth = headlessOptions.width;
+        framebufferHeight = headlessOptions.height;
+        camera.SetViewportSize(framebufferWidth, framebufferHeight);
+        if (!cameraPlayer.empty())
+        {
+            // Записанный путь задает и шаг времени, и (если не указано иное) количество кадров
+            headlessOptions.timeStep = cameraPlayer.timeStep();
+            if (!launchOptions.framesSet)
+                headlessOptions.frames = static_cast<int>(cameraPlayer.size());
+        }
+        return runHeadlessBenchmark(headlessOptions, [](FrameState& state, double time) {
+            if (!cameraPlayer.empty())
+                cameraPlayer.apply(camera, time);
+            updateFrameState(state, camera, time);
+        }, sharedWorkers());
+    }
+
     // glfw: инициализация и конфигурирование
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -59,7 +202,8 @@ int main()
         glfwTerminate();
         return -1;
     }
-    glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    camera.SetViewportSize(framebufferWidth, framebufferHeight);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
@@ -67,12 +211,113 @@ int main()
     // Сообщаем GLFW, чтобы он захватил наш курсор
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    // Первый снимок публикуем до старта рендеринга, чтобы рендереру всегда было что рисовать
+    updateFrameState(frameStates.writeBuffer(), camera, 0.0);
+    frameStates.publish();
+
+    // GL-контекст принадлежит потоку рендеринга: он загружает ресурсы и рисует, пока этот поток обрабатывает ввод
+    std::thread renderThread(renderThreadMain, window);
+
+    PROFILE_THREAD_NAME("update");
+
+    // Цикл обновления
+    auto nextTick = std::chrono::steady_clock::now();
+    // Камера снимков живет все время цикла: за кадр в нее переносится интерполированная позиция,
+    // а углы и Zoom - только при изменении, чтобы не пересчитывать векторы и проекцию каждый кадр
+    Camera viewCamera = camera;
+    double lastFrame = glfwGetTime();
+    while (!glfwWindowShouldClose(window))
+    {
+        // Логическая часть работы со временем для каждого кадра
+        double currentFrame = glfwGetTime();
+        simulationAccumulator += std::min(currentFrame - lastFrame, MAX_FRAME_TIME);
+        lastFrame = currentFrame;
+
+        // Отслеживание событий ввода/вывода (была ли нажата/отпущена кнопка, перемещен курсор мыши и т.п.)
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+
+        // Обработка ввода
+        processInput(window);
+
+        // Шаги симуляции за прошедшее время; доля следующего шага остается в накопителе
+        while (simulationAccumulator >= SIMULATION_STEP)
+        {
+            previousSimulationTime = simulationTime;
+            previousCameraPosition = camera.Position;
+            stepSimulation(window, static_cast<float>(SIMULATION_STEP));
+            simulationTime += SIMULATION_STEP;
+            simulationAccumulator -= SIMULATION_STEP;
+        }
+        double alpha = simulationAccumulator / SIMULATION_STEP;
+        double sceneTime = previousSimulationTime + (simulationTime - previousSimulationTime) * alpha;
+
+        glm::vec3 viewPosition = glm::mix(previousCameraPosition, camera.Position, static_cast<float>(alpha));
+        viewCamera.SetViewportSize(framebufferWidth, framebufferHeight);
+        if (viewCamera.Yaw != camera.Yaw || viewCamera.Pitch != camera.Pitch || viewCamera.Zoom != camera.Zoom)
+            viewCamera.SetPose(viewPosition, camera.Yaw, camera.Pitch, camera.Zoom);
+        else
+            viewCamera.SetPosition(viewPosition);
+
+        // При воспроизведении камера идет по записанному пути по тем же часам симуляции, поэтому скорость
+        // воспроизведения не зависит от частоты обновления (путь сам интерполируется между своими шагами)
+        if (!cameraPlayer.empty())
+        {
+            cameraPlayer.apply(viewCamera, sceneTime);
+            if (sceneTime >= cameraPlayer.duration())
+                glfwSetWindowShouldClose(window, true);
+        }
+        cameraRecorder.record(viewCamera, sceneTime);
+
+        // Подготавливаем и публикуем новый снимок сцены
+        {
+            PROFILE_ZONE("updateFrameState");
+            updateFrameState(frameStates.writeBuffer(), viewCamera, sceneTime);
+            frameStates.publish();
+        }
+
+        // Ограничиваем частоту обновления
+        nextTick += std::chrono::milliseconds(FRAME_LOCK_PERIOD);
+        auto now = std::chrono::steady_clock::now();
+        if (nextTick > now)
+            std::this_thread::sleep_until(nextTick);
+        else
+            nextTick = now;
+    }
+
+    renderRunning = false;
+    renderThread.join();
+
+    // Все инструментированные потоки остановлены, можно сохранить трассу
+    PROFILE_EXPORT("cpu_trace.json");
+
+    cameraRecorder.close();
+
+    // glfw: завершение, освобождение всех выделенных ранее GLFW-реcурсов
+    glfwTerminate();
+    return 0;
+}
+
+// Поток рендеринга: владеет GL-контекстом и всегда рисует самый свежий снимок сцены
+void renderThreadMain(GLFWwindow* window)
+{
+    PROFILE_THREAD_NAME("render");
+
+    glfwMakeContextCurrent(window);
+
     // glad: загрузка всех указателей на OpenGL-функции
     if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        glfwSetWindowShouldClose(window, true);
+        return;
     }
+    GLExtensions::load(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+
+    // Темп рендеринга задает вертикальная синхронизация
+    glfwSwapInterval(1);
 
     // Сообщаем stb_image.h, чтобы он перевернул загруженные текстуры относительно y-оси (до загрузки модели)
     stbi_set_flip_vertically_on_load(true);
@@ -80,109 +325,219 @@ int main()
     // Конфигурирование глобального состояния OpenGL
     glEnable(GL_DEPTH_TEST);
 
-    // Компилирование нашей шейдерной программы
-    Shader lightSourceShader("../onion/shaders/modelSource.vs", "../onion/shaders/modelSource.fs");
-    Shader planetShader("../onion/shaders/1.model_loading.vs", "../onion/shaders/1.model_loading.fs");
+    // Отрисовка в режиме каркаса
+//     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    // Загрузка моделей
-    Model solarSystem_mars("../onion/models/mars.obj");
-//    Model solarSystem_mars("textures/backpack/backpack.obj");
-    Model solarSystem_star("../onion/models/sun.obj");
-    Model solarSystem_milkyWay("../onion/models/milkyWay.obj");
+    {
+        // Компилирование шейдеров и загрузка моделей
+        Renderer renderer(sharedWorkers());
 
+        // Цикл рендеринга
+        while (renderRunning)
+        {
+            frameStates.update();
+            renderer.Draw(frameStates.readBuffer());
 
-    // Отрисовка в режиме каркаса
-//     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            // glfw: обмен содержимым front- и back- буферов
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
 
-    // Позиция источника света.
-    glm::vec3 lightPosition(0.0f, 0.0f, 10.0f);
+        // Сохраняем накопленные времена GPU-проходов
+        renderer.gpuProfiler().exportCsv("gpu_profile.csv");
+        renderer.gpuProfiler().exportChromeTrace("gpu_trace.json");
+        GpuMemory::report(std::cout);
+    }
+    // Ресурсы сцены уже в очереди удаления; контекст еще текущий, удаляем их, не дожидаясь заборов
+    GLDeletionQueue::flush();
 
-    // Цикл рендеринга
-    while (!glfwWindowShouldClose(window))
+    glfwMakeContextCurrent(nullptr);
+}
+
+// Разбираем аргументы командной строки
+void parseCommandLine(int argc, char** argv, LaunchOptions& options)
+{
+    HeadlessOptions& headless = options.headlessOptions;
+    for (int i = 1; i < argc; i++)
     {
-        // Логическая часть работы со временем для каждого кадра
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        if (deltaTime < FRAME_LOCK_PERIOD)
+        if (std::strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
         {
-            this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(FRAME_LOCK_PERIOD - deltaTime)));
+            headless.frames = std::max(1, std::atoi(argv[++i]));
+            options.framesSet = true;
         }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &headless.width, &headless.height) != 2 || headless.width <= 0 || headless.height <= 0)
+            {
+                std::cout << "Invalid --size, expected WxH" << std::endl;
+                headless.width = static_cast<int>(SCR_WIDTH);
+                headless.height = static_cast<int>(SCR_HEIGHT);
+            }
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            options.replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--deferred") == 0)
+            renderPath = RenderPath::Deferred;
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+            scenePointLights = std::min(static_cast<unsigned int>(std::max(0, std::atoi(argv[++i]))), MAX_POINT_LIGHTS);
+        else if (std::strcmp(argv[i], "--bench-lighting") == 0)
+            headless.lightingSweep = true;
+        else if (std::strcmp(argv[i], "--bench-transforms") == 0)
+        {
+            options.transformBenchmark = 100000;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                options.transformBenchmark = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--bench-orbits") == 0)
+        {
+            options.orbitBenchmark = 100000;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                options.orbitBenchmark = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--asteroids") == 0 && i + 1 < argc)
+            sceneAsteroids = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--nbody") == 0)
+            asteroidIntegrator = OrbitalSystem::Integrator::BarnesHut;
+        else if (std::strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+            GpuMemory::setBudget(static_cast<size_t>(std::max(0, std::atoi(argv[++i]))) * 1024 * 1024);
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            options.packPath = argv[++i];
+        else if (std::strcmp(argv[i], "--build-pack") == 0 && i + 1 < argc)
+            options.buildPackPath = argv[++i];
+        else if (std::strcmp(argv[i], "--bench-obj") == 0)
+        {
+            options.objBenchmarkPath = std::string(ASSET_ROOT) + "/models/фонарь.obj";
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                options.objBenchmarkPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--assimp-obj") == 0)
+            ModelImport::setFastObj(false);
+    }
+}
+
+// Вычисляем снимок сцены для момента времени time с камеры viewCamera
+void updateFrameState(FrameState& state, const Camera& viewCamera, double time)
+{
+    // Позиция источника света.
+    const glm::vec3 lightPosition(0.0f, 0.0f, 10.0f);
+
+    // Преобразования Вида/Проекции
+    state.projection = viewCamera.GetProjectionMatrix();
+    state.view = viewCamera.GetViewMatrix();
+
+    // Звезда
+    sceneTransforms.setPosition(starTransform, lightPosition);
+
+    // Планета
+    // Углы приводим к периоду в double: float-время теряет точность уже через несколько часов работы
+    float rotationAngle = static_cast<float>(std::fmod(time / 10.0, TWO_PI));
+    sceneTransforms.setRotation(planetTransform, glm::angleAxis(rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::mat4 sourceLightRotationMatrix(1.0f);
+    sourceLightRotationMatrix = glm::rotate(sourceLightRotationMatrix, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    state.lightPosition = glm::vec3(glm::vec4(lightPosition, 1.0f) * sourceLightRotationMatrix);
+
+    // Точечные источники
+    updatePointLights(state, time);
+
+    // Небесная сфера: сдвиг откладывается от позиции звезды, поэтому центр сферы - в удвоенной позиции источника
+    sceneTransforms.setPosition(skyTransform, lightPosition * 2.0f);
+    sceneTransforms.setScale(skyTransform, glm::vec3(50.0f));
+
+    // Пояс астероидов
+    asteroidOrbits.propagate(time, &sharedWorkers());
+    asteroidOrbits.writePositions(sceneTransforms, firstAsteroidTransform);
+
+    sceneTransforms.compose(&sharedWorkers());
+    state.starModel = sceneTransforms.world(starTransform);
+    state.planetModel = sceneTransforms.world(planetTransform);
+    state.skyModel = sceneTransforms.world(skyTransform);
+    const std::vector<glm::mat4>& world = sceneTransforms.worldMatrices();
+    state.asteroidModels.assign(world.begin() + firstAsteroidTransform, world.begin() + firstAsteroidTransform + asteroidOrbits.size());
+
+    state.framebufferWidth = framebufferWidth;
+    state.framebufferHeight = framebufferHeight;
+    state.showGpuOverlay = showGpuOverlay;
+    state.renderPath = renderPath;
+    static unsigned long long frameCounter = 0;
+    state.frameIndex = ++frameCounter;
+}
 
-        // Обработка ввода
-        processInput(window);
 
-        // Рендеринг
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Убеждаемся, что активировали шейдер прежде, чем настраивать uniform-переменные/объекты_рисования
-        lightSourceShader.use();
-
-        // Преобразования Вида/Проекции
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightSourceShader.setMat4("projection", projection);
-        lightSourceShader.setMat4("view", view);
-
-        // Рендеринг загруженной модели
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPosition); // смещаем вниз чтобы быть в центре сцены
-        model = glm::scale(model, glm::vec3(1.f, 1.f, 1.f));	// объект слишком большой для нашей сцены, поэтому немного уменьшим его
-//        model = glm::rotate(model, currentFrame/10, glm::vec3(0.0f, 1.0f, 0.0f));
-        lightSourceShader.setMat4("model", model);
-        solarSystem_star.Draw(lightSourceShader);
-
-        // Убеждаемся, что активировали шейдер прежде, чем настраивать uniform-переменные/объекты_рисования
-        planetShader.use();
-
-        // Преобразования Вида/Проекции
-        glm::mat4 projectionbp = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), 0.1f, 100.0f);
-        glm::mat4 viewbp = camera.GetViewMatrix();
-        planetShader.setMat4("projection", projectionbp);
-        planetShader.setMat4("view", viewbp);
-
-        // Рендеринг загруженной модели
-        glm::mat4 modelbp = glm::mat4(1.0f);
-        modelbp = glm::translate(modelbp, glm::vec3(0.0f, 0.0f, 0.0f)); // смещаем вниз чтобы быть в центре сцены
-        modelbp = glm::scale(modelbp, glm::vec3(1.f, 1.f, 1.f));
-        float rotationAngle = static_cast<float>(currentFrame)/10;
-        modelbp = glm::rotate(modelbp, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 sourceLightRotationMatrix(1.0f);
-        sourceLightRotationMatrix = glm::rotate(sourceLightRotationMatrix, rotationAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::vec3 currentLightSourcePosition((glm::vec4(lightPosition, 1.0f) * sourceLightRotationMatrix));
-
-        planetShader.setVec3("sourceLightPos", currentLightSourcePosition);
-
-        planetShader.setMat4("model", modelbp);
-        solarSystem_mars.Draw(planetShader);
-
-        // Убеждаемся, что активировали шейдер прежде, чем настраивать uniform-переменные/объекты_рисования
-        lightSourceShader.use();
-
-        // Преобразования Вида/Проекции
-        glm::mat4 projectionw = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), 0.1f, 100.0f);
-        glm::mat4 vieww = camera.GetViewMatrix();
-        lightSourceShader.setMat4("projection", projectionw);
-        lightSourceShader.setMat4("view", vieww);
-
-        // Рендеринг загруженной модели
-        glm::mat4 modelw = glm::mat4(1.0f);
-        modelw = glm::translate(model, lightPosition); // смещаем вниз чтобы быть в центре сцены
-        modelw = glm::scale(modelw, glm::vec3(50.f, 50.f, 50.f));
-        lightSourceShader.setMat4("model", modelw);
-        solarSystem_milkyWay.Draw(lightSourceShader);
-
-
-
-        // glfw: обмен содержимым front- и back- буферов. Отслеживание событий ввода/вывода (была ли нажата/отпущена кнопка, перемещен курсор мыши и т.п.)
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+
+void updatePointLights(FrameState& state, double time)
+{
+    // Станции на наклонных круговых орбитах вокруг планеты. Параметры орбит разнесены золотым углом,
+    // чтобы огни не собирались в одной плоскости. Заполняются все MAX_POINT_LIGHTS источников, чтобы замер
+    // освещения (--bench-lighting) мог менять их число, не пересчитывая сцену
+    const float goldenAngle = 2.39996323f;
+    const glm::vec3 palette[4] = {
+        glm::vec3(1.0f, 0.55f, 0.2f),
+        glm::vec3(0.3f, 0.6f, 1.0f),
+        glm::vec3(0.4f, 1.0f, 0.5f),
+        glm::vec3(1.0f, 0.3f, 0.6f)
+    };
+
+    state.pointLightCount = scenePointLights;
+    for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++)
+    {
+        float orbitRadius = 1.3f + 0.25f * static_cast<float>(i % 4);
+        float inclination = goldenAngle * static_cast<float>(i);
+        float phase = static_cast<float>(std::fmod(time * (0.2 + 0.05 * static_cast<double>(i % 5)), TWO_PI));
+        float angle = goldenAngle * static_cast<float>(i * 7) + phase;
+
+        glm::vec3 orbit(std::cos(angle) * orbitRadius, 0.0f, std::sin(angle) * orbitRadius);
+        glm::mat4 tilt = glm::rotate(glm::mat4(1.0f), inclination, glm::vec3(1.0f, 0.0f, 0.0f));
+
+        PointLight& light = state.pointLights[i];
+        light.position = glm::vec3(tilt * glm::vec4(orbit, 1.0f));
+        light.radius = 0.9f;
+        light.color = palette[i % 4];
+        light.intensity = 1.5f;
     }
+}
 
-    // glfw: завершение, освобождение всех выделенных ранее GLFW-реcурсов
-    glfwTerminate();
-    return 0;
+void setupAsteroids()
+{
+    // Повторяемый пояс: почти круговые орбиты с малым наклоном между 2.4 и 3.6 радиуса планеты,
+    // случайные ориентация и размер каждого камня
+    std::mt19937 random(20240611);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float twoPi = static_cast<float>(TWO_PI);
+
+    asteroidOrbits.reserve(sceneAsteroids);
+    sceneTransforms.reserve(sceneTransforms.size() + sceneAsteroids);
+    firstAsteroidTransform = static_cast<TransformSystem::Handle>(sceneTransforms.size());
+    for (unsigned int i = 0; i < sceneAsteroids; i++)
+    {
+        OrbitalElements elements;
+        elements.semiMajorAxis = 2.4f + 1.2f * unit(random);
+        elements.eccentricity = 0.08f * unit(random);
+        elements.inclination = 0.05f * (unit(random) - 0.5f);
+        elements.ascendingNode = twoPi * unit(random);
+        elements.argumentOfPeriapsis = twoPi * unit(random);
+        elements.meanAnomaly = twoPi * unit(random);
+        // Суммарная масса пояса - тысячная доля массы планеты
+        asteroidOrbits.add(elements, ASTEROID_CENTRAL_GM * 1e-3f / static_cast<float>(std::max(sceneAsteroids, 1u)));
+
+        glm::quat rotation = glm::normalize(glm::quat(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f));
+        glm::vec3 scale = glm::vec3(0.01f + 0.025f * unit(random)) * glm::vec3(1.0f, 0.6f + 0.4f * unit(random), 0.8f + 0.2f * unit(random));
+        sceneTransforms.create(glm::vec3(0.0f), rotation, scale);
+    }
+    asteroidOrbits.setIntegrator(asteroidIntegrator);
+}
+
+
+
+// Единственный пул рабочих потоков программы: снимки сцены (поток обновления), подготовка кадра (поток рендеринга)
+// и упаковка мешей моделей. Циклы разных потоков идут одновременно и делят рабочие потоки (см. ThreadPool::parallelFor)
+ThreadPool& sharedWorkers()
+{
+    static ThreadPool workers;
+    return workers;
 }
 
 // Обработка всех событий ввода: запрос GLFW о нажатии/отпускании кнопки мыши в данном кадре и соответствующая обработка данных событий
@@ -191,27 +546,51 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // Поворачиваем камеру один раз за кадр на сумму смещений мыши, пришедших с прошлого кадра.
+    // Поворот не интерполируется: взгляд должен следовать за мышью без задержки на шаг симуляции
+    camera.ApplyMouseMovement();
+
+    // F1 - показать/скрыть полосы времени GPU-проходов (переключаем по нажатию, а не пока кнопка зажата)
+    static bool overlayKeyWasPressed = false;
+    bool overlayKeyPressed = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (overlayKeyPressed && !overlayKeyWasPressed)
+        showGpuOverlay = !showGpuOverlay;
+    overlayKeyWasPressed = overlayKeyPressed;
+
+    // F2 - переключить прямое/отложенное освещение
+    static bool renderPathKeyWasPressed = false;
+    bool renderPathKeyPressed = glfwGetKey(window, GLFW_KEY_F2) == GLFW_PRESS;
+    if (renderPathKeyPressed && !renderPathKeyWasPressed)
+        renderPath = renderPath == RenderPath::Forward ? RenderPath::Deferred : RenderPath::Forward;
+    renderPathKeyWasPressed = renderPathKeyPressed;
+}
+
+// Один шаг симуляции: перемещение камеры по зажатым клавишам за время step
+void stepSimulation(GLFWwindow* window, float step)
+{
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        camera.ProcessKeyboard(FORWARD, step);
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        camera.ProcessKeyboard(BACKWARD, step);
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        camera.ProcessKeyboard(LEFT, step);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        camera.ProcessKeyboard(RIGHT, step);
     if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
-        camera.ProcessKeyboard(DOWN, deltaTime);
+        camera.ProcessKeyboard(DOWN, step);
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
-        camera.ProcessKeyboard(UP, deltaTime);
+        camera.ProcessKeyboard(UP, step);
 }
 
 // glfw: всякий раз, когда изменяются размеры окна (пользователем или операционной системой), вызывается данная callback-функция
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     (void)window;
-    // Убеждаемся, что окно просмотра соответствует новым размерам окна.
+    // Запоминаем новые размеры, окно просмотра обновит поток рендеринга при отрисовке следующего снимка.
     // Обратите внимание, ширина и высота будут значительно больше, чем указано, на Retina-дисплеях
-    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    camera.SetViewportSize(width, height);
 }
 
 // glfw: всякий раз, когда перемещается мышь, вызывается данная callback-функция
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief MappedFile - Файл, отображенный в память только для чтения. Страницы подгружает ОС по мере обращения,
+ * поэтому чтение большого файла не требует ни буфера в памяти процесса, ни копирования.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Пустой файл не отображается: open вернет false
+    bool open(const std::string& path);
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const unsigned char*    m_data = nullptr;
+    size_t                  m_size = 0;
+#ifdef _WIN32
+    // HANDLE файла и отображения; windows.h подключается только в mappedfile.cpp
+    void*                   m_file = nullptr;
+    void*                   m_mapping = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,68 @@
+#include "material.h"
+#include "gpumemory.h"
+
+#include <cstdlib>
+#include <cstring>
+
+Material::Material(const Texture* textures, size_t count)
+{
+    unsigned int counts[TEXTURE_SLOT_COUNT] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        const Texture& texture = textures[i];
+        unsigned int& slotCount = counts[texture.slot];
+        if (slotCount >= MAX_TEXTURES_PER_SLOT)
+            continue;
+
+        Binding& binding = m_bindings[m_bindingCount++];
+        binding.unit = GL_TEXTURE0 + textureUnit(texture.slot, slotCount);
+        binding.handle = texture.id;
+        binding.resource = texture.resource;
+        m_slots |= 1u << texture.slot;
+        slotCount++;
+    }
+}
+
+
+
+void Material::bind() const
+{
+    for (unsigned int i = 0; i < m_bindingCount; i++)
+    {
+        glActiveTexture(m_bindings[i].unit);
+        glBindTexture(GL_TEXTURE_2D, m_bindings[i].handle);
+        GpuMemory::use(m_bindings[i].resource);
+    }
+}
+
+
+
+bool Material::has(TextureSlot slot) const
+{
+    return (m_slots & (1u << slot)) != 0;
+}
+
+
+
+bool Material::parseSampler(const char* name, TextureSlot& slot, unsigned int& index)
+{
+    for (unsigned int i = 0; i < TEXTURE_SLOT_COUNT; i++)
+    {
+        const char* prefix = textureSlotName(static_cast<TextureSlot>(i));
+        size_t length = std::strlen(prefix);
+        if (std::strncmp(name, prefix, length) != 0)
+            continue;
+
+        // После префикса должен идти только номер N = 1..MAX_TEXTURES_PER_SLOT
+        const char* digits = name + length;
+        char* end = nullptr;
+        long number = std::strtol(digits, &end, 10);
+        if (end == digits || *end != '\0' || number < 1 || number > static_cast<long>(MAX_TEXTURES_PER_SLOT))
+            return false;
+
+        slot = static_cast<TextureSlot>(i);
+        index = static_cast<unsigned int>(number - 1);
+        return true;
+    }
+    return false;
+}
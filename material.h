@@ -0,0 +1,56 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include "Texture.hpp"
+
+#include <cstddef>
+
+/**
+ * @brief Material - Неизменяемая группа привязок текстур материала, которая строится один раз при загрузке.
+ * Каждая текстура заранее получает постоянный текстурный юнит (textureUnit), а программы получают те же юниты
+ * в своих сэмплерах при сборке (Shader::finalize). Поэтому привязка материала в кадре - короткий цикл
+ * glActiveTexture/glBindTexture по упакованному массиву, без строк, поиска uniform-переменных и выделений памяти.
+ */
+class Material
+{
+public:
+    Material() = default;
+
+    /**
+     * @brief Material - Строим привязки по текстурам меша. Текстуры одного слота нумеруются в порядке следования
+     * (texture_diffuse1, texture_diffuse2, ...), текстуры сверх MAX_TEXTURES_PER_SLOT пропускаются.
+     */
+    Material(const Texture* textures, size_t count);
+
+    // Привязываем все текстуры материала к их юнитам
+    void bind() const;
+
+    // Есть ли в материале текстура указанного слота
+    bool has(TextureSlot slot) const;
+
+    /**
+     * @brief parseSampler - Разбираем имя сэмплера по соглашению texture_<слот>N.
+     * @param name - Имя активной uniform-переменной.
+     * @param slot - Слот текстуры.
+     * @param index - Номер текстуры в слоте, начиная с 0 (N - 1).
+     * @return false, если имя не следует соглашению.
+     */
+    static bool parseSampler(const char* name, TextureSlot& slot, unsigned int& index);
+
+private:
+    struct Binding
+    {
+        GLenum          unit;       // GL_TEXTURE0 + юнит
+        GLuint          handle;     // Идентификатор текстуры
+        unsigned int    resource;   // Учет в GpuMemory
+    };
+
+    // Привязок не больше, чем юнитов материалов, поэтому они хранятся внутри объекта, без выделений в куче
+    Binding                 m_bindings[TEXTURE_SLOT_COUNT * MAX_TEXTURES_PER_SLOT];
+    unsigned int            m_bindingCount = 0;
+    unsigned int            m_slots = 0;    // Биты (1 << TextureSlot) присутствующих слотов
+};
+
+#endif // MATERIAL_H
@@ -1,243 +1,448 @@
 #include "model.h"
+#include "cpuprofiler.h"
 
-Model::Model(const string& path, bool gamma) : m_gammaCorrection(gamma)
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
 {
-    loadModel(path);
+    // Разрешение сферы-заглушки: долгота x широта
+    const unsigned int PLACEHOLDER_SEGMENTS = 16;
+    const unsigned int PLACEHOLDER_RINGS = 8;
+
+    // Загружаем изображение в текстуру texture (привязывается к GL_TEXTURE_2D) и строим весь мипмап
+    void fillTexture(GLuint texture, const DecodedImage& image)
+    {
+        GLenum format;
+        switch (image.components)
+        {
+            case 1: format = GL_RED; break;
+            case 2: format = GL_RG; break;
+            case 3: format = GL_RGB; break;
+            case 4: format = GL_RGBA; break;
+            default:
+                std::cout << "ERROR::TEXTURE::UNSUPPORTED_COMPONENT_COUNT " << image.components << std::endl;
+                return;
+        }
+
+        // Строки изображения stb_image упакованы плотно, а GL по умолчанию ждет выравнивания по 4 байта
+        GLint unpackAlignment = 4;
+        const bool unaligned = (static_cast<size_t>(image.width) * image.components) % 4 != 0;
+        if (unaligned)
+        {
+            glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.get());
+        if (unaligned)
+            glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+        // GpuMemory мог сократить цепочку уровней, уменьшая текстуру
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
 }
 
 
 
-Model::~Model()
+Model::Model(const string& path, const ImportProfile& profile, bool gamma) : Model(path, profile, Loading::Blocking, gamma)
+{
+}
+
+
+
+Model::Model(const string& path, const ImportProfile& profile, Loading loading, bool gamma) : m_profile(profile), m_gammaCorrection(gamma)
 {
-    for (Mesh* ptr : m_meshes)
+    if (loading == Loading::Blocking)
     {
-        delete ptr;
+        PROFILE_ZONE("Model::loadModel");
+        receiveSource(ModelImport::load(path, m_profile));
+        finishLoading();
+        return;
     }
-    m_meshes.clear();
+
+    // Импорт и декодирование текстур не касаются GL, поэтому идут в отдельном потоке со своим Assimp::Importer.
+    // Пока они идут, модель рисуется заглушкой
+    m_import = std::async(std::launch::async, ModelImport::load, path, m_profile, static_cast<ThreadPool*>(nullptr));
+    createPlaceholder();
 }
 
 
 
-void Model::Draw(Shader& shader)
+Model::Model(future<ModelSource> scene, shared_future<ImportProfile> profile, ThreadPool* workers, bool gamma)
+    : m_profile(ImportProfile::all()), m_gammaCorrection(gamma), m_pendingProfile(profile)
+{
+    // Файл мог еще читаться: дожидаемся его и профиля в фоновом потоке и там же доводим источник до профиля
+    m_import = std::async(std::launch::async, [workers](future<ModelSource> pending, shared_future<ImportProfile> profile) {
+        ModelSource source = pending.get();
+        ModelImport::prepare(source, profile.get(), workers);
+        return source;
+    }, std::move(scene), std::move(profile));
+    createPlaceholder();
+}
+
+
+
+Model::~Model()
 {
-    for(unsigned int i = 0; i < m_meshes.size(); i++)
-        m_meshes[i]->Draw(shader);
+    // Фоновый импорт дорабатывает до конца: future из std::async ждет его в своем деструкторе.
+    // Меши и текстуры отдают свои GL-объекты в GLDeletionQueue
+    m_meshes.clear();
+    m_placeholder.clear();
+    for (const Texture& image : m_images)
+        GpuMemory::release(image.resource);
+    m_textures.clear();
 }
 
 
 
-void Model::loadModel(const string& path)
+bool Model::update(size_t uploadBytes)
 {
-    // Чтение файла с помощью Assimp
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    if (m_ready)
+    {
+        restoreTextures();
+        return false;
+    }
 
-    // Проверка на ошибки
-    if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // если НЕ 0
+    if (m_import.valid())
     {
-        cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-        return;
+        if (m_import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return false;
+        // Фоновый импорт уже получил профиль, get() не ждет
+        if (m_pendingProfile.valid())
+        {
+            m_profile = m_pendingProfile.get();
+            m_pendingProfile = shared_future<ImportProfile>();
+        }
+        receiveSource(m_import.get());
     }
 
-    // Получение пути к файлу
-    m_directory = path.substr(0, path.find_last_of('/'));
+    if (!uploadStep(uploadBytes))
+        return false;
+
+    // Группируем меши по флагам материала, чтобы при отрисовке вариантами программа менялась как можно реже
+    std::stable_sort(m_meshes.begin(), m_meshes.end(), [](const Mesh& a, const Mesh& b) {
+        return a.materialFeatures() < b.materialFeatures();
+    });
 
-    // Рекурсивная обработка корневого узла Assimp
-    processNode(scene->mRootNode, scene);
+    // Сцена Assimp и декодированные изображения больше не нужны
+    m_source = ModelSource();
+    m_placeholder.clear();
+    m_placeholderTexture.reset();
+    m_ready = true;
+    return true;
 }
 
 
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+bool Model::finishLoading()
 {
-    // Обрабатываем каждый меш текущего узла
-    for(unsigned int i = 0; i < node->mNumMeshes; i++)
-    {
-        // Узел содержит только индексы объектов в сцене.
-        // Сцена же содержит все данные; узел - это лишь способ организации данных
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        m_meshes.push_back(processMesh(mesh, scene));
-    }
-    // После того, как мы обработали все меши (если таковые имелись), мы начинаем рекурсивно обрабатывать каждый из дочерних узлов
-    for(unsigned int i = 0; i < node->mNumChildren; i++)
+    if (m_import.valid())
+        m_import.wait();
+    return update(std::numeric_limits<size_t>::max());
+}
+
+
+
+bool Model::isReady() const
+{
+    return m_ready;
+}
+
+
+
+void Model::Draw(Shader& shader)
+{
+    for (Mesh& mesh : drawnMeshes())
+        mesh.Draw(shader);
+}
+
+
+
+void Model::Draw(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind)
+{
+    drawVariants(variants, features, bind, 0, 0);
+}
+
+
+
+void Model::DrawInstanced(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind,
+                          unsigned int instanceBuffer, GLsizei count)
+{
+    drawVariants(variants, features | INSTANCED, bind, instanceBuffer, count);
+}
+
+
+
+vector<unsigned int> Model::variantKeys(unsigned int features) const
+{
+    vector<unsigned int> keys;
+    for (const Mesh& mesh : drawnMeshes())
     {
-        processNode(node->mChildren[i], scene);
+        unsigned int key = ShaderVariants::normalize(features | mesh.materialFeatures());
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+            keys.push_back(key);
     }
+    return keys;
+}
+
+
 
+vector<Mesh>& Model::drawnMeshes()
+{
+    return m_ready ? m_meshes : m_placeholder;
 }
 
 
 
-Mesh* Model::processMesh(aiMesh* mesh, const aiScene* scene)
+const vector<Mesh>& Model::drawnMeshes() const
 {
-    // Данные для заполнения
-    vector<Vertex> vertices;
-    vector<unsigned int> indices;
-    vector<Texture> textures;
+    return m_ready ? m_meshes : m_placeholder;
+}
+
+
 
-    // Цикл по всем вершинам меша
-    for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+void Model::drawVariants(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind,
+                         unsigned int instanceBuffer, GLsizei count)
+{
+    unsigned int currentKey = ~0u;
+    Shader* shader = nullptr;
+    for (Mesh& mesh : drawnMeshes())
     {
-        Vertex vertex;
-        // мы объявляем промежуточный вектор, т.к. Assimp использует свой собственный векторный класс,
-        // который не преобразуется напрямую в тип glm::vec3,
-        // поэтому сначала мы передаем данные в этот промежуточный вектор типа glm::vec3
-        glm::vec3 vector;
-
-        // Координаты
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
-        vertex.position = vector;
-
-        // Нормали
-        vector.x = mesh->mNormals[i].x;
-        vector.y = mesh->mNormals[i].y;
-        vector.z = mesh->mNormals[i].z;
-        vertex.normal = vector;
-
-        // Текстурные координаты
-        if(mesh->mTextureCoords[0]) // если меш содержит текстурные координаты
+        unsigned int key = ShaderVariants::normalize(features | mesh.materialFeatures());
+        if (key != currentKey)
         {
-            glm::vec2 vec;
-
-            // Вершина может содержать до 8 различных текстурных координат. Мы предполагаем, что мы не будем использовать модели,
-            // в которых вершина может содержать несколько текстурных координат, поэтому мы всегда берем первый набор (0)
-            vec.x = mesh->mTextureCoords[0][i].x;
-            vec.y = mesh->mTextureCoords[0][i].y;
-            vertex.texCoords = vec;
+            shader = &variants.get(key);
+            shader->use();
+            bind(*shader);
+            currentKey = key;
         }
+
+        if (count > 0)
+            mesh.DrawInstanced(*shader, instanceBuffer, count);
         else
-            vertex.texCoords = glm::vec2(0.0f, 0.0f);
-
-        // Касательный вектор
-        vector.x = mesh->mTangents[i].x;
-        vector.y = mesh->mTangents[i].y;
-        vector.z = mesh->mTangents[i].z;
-        vertex.tangent = vector;
-
-        // Вектор бинормали
-        vector.x = mesh->mBitangents[i].x;
-        vector.y = mesh->mBitangents[i].y;
-        vector.z = mesh->mBitangents[i].z;
-        vertex.bitangent = vector;
-        vertices.push_back(vertex);
+            mesh.Draw(*shader);
     }
-    // Теперь проходимся по каждой грани меша (грань - это треугольник меша) и извлекаем соответствующие индексы вершин
-    for(unsigned int i = 0; i < mesh->mNumFaces; i++)
-    {
-        aiFace face = mesh->mFaces[i];
+}
+
 
-        // Получаем все индексы граней и сохраняем их в векторе indices
-        for(unsigned int j = 0; j < face.mNumIndices; j++)
-            indices.push_back(face.mIndices[j]);
+
+void Model::receiveSource(ModelSource source)
+{
+    m_source = std::move(source);
+    m_images.resize(m_source.images.size());
+    m_directory = m_source.directory;
+    for (const DecodedImage& image : m_source.images)
+        m_imagePaths.push_back(image.path);
+    // Меши займут один массив, выделенный сразу на всю модель
+    m_meshes.reserve(m_source.meshes.size());
+}
+
+
+
+bool Model::uploadStep(size_t uploadBytes)
+{
+    PROFILE_ZONE("Model::uploadStep");
+
+    // За вызов загружается хотя бы один объект, поэтому загрузка продвигается при любом бюджете
+    size_t uploaded = 0;
+
+    // Сначала изображения: на них ссылаются материалы мешей
+    for (; m_nextImage < m_source.images.size(); m_nextImage++)
+    {
+        if (uploaded > 0 && uploaded >= uploadBytes)
+            return false;
+
+        DecodedImage& image = m_source.images[m_nextImage];
+        // При нехватке видеопамяти у текстуры можно отбросить верхние уровни мипмапа
+        m_textures.push_back(uploadTexture(image));
+        Texture& texture = m_images[m_nextImage];
+        texture.id = m_textures.back();
+        texture.slot = TEXTURE_SLOT_DIFFUSE;
+        texture.resource = GpuMemory::trackTexture(texture.id, GPU_MEMORY_TEXTURES, true);
+        uploaded += std::max<size_t>(image.bytes(), 1);
+        image.pixels.reset();
     }
 
-    // Обрабатываем материалы
-    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    // Список текстур меша переиспользуется: после первого меша он не обращается к куче
+    std::vector<Texture> textures;
+    const size_t vertexBytes = vertexStride(m_source.vertexStreams) * sizeof(float);
+    for (; m_nextMesh < m_source.meshes.size(); m_nextMesh++)
+    {
+        if (uploaded > 0 && uploaded >= uploadBytes)
+            return false;
+
+        // Текстуры меша - загруженные изображения в слотах его материала
+        textures.clear();
+        for (size_t i = m_source.textureOffsets[m_nextMesh]; i < m_source.textureOffsets[m_nextMesh + 1]; i++)
+        {
+            const MeshTextureRef& ref = m_source.textures[i];
+            textures.push_back(m_images[ref.image]);
+            textures.back().slot = ref.slot;
+        }
 
-    // Мы вводим соглашение об именах сэмплеров в шейдерах. Каждая диффузная текстура будет называться 'texture_diffuseN',
-    // где N - порядковый номер от 1 до MAX_SAMPLER_NUMBER.
-    // Тоже самое относится и к другим текстурам:
-    // диффузная - texture_diffuseN
-    // отражения - texture_specularN
-    // нормали - texture_normalN
+        const MeshRange& range = m_source.meshes[m_nextMesh];
+        m_meshes.push_back(processMesh(range, textures.data(), textures.size()));
+        uploaded += std::max<size_t>(range.vertexCount * vertexBytes + range.indexCount * sizeof(unsigned int), 1);
+    }
+    return true;
+}
 
-    // 1. Диффузные карты
-    vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, /*"2k_sun"*/ "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 
-    // 2. Карты отражения
-    vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, /*"2k_sun"*/ "texture_specular");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 
-    // 3. Карты нормалей
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+Mesh Model::processMesh(const MeshRange& range, const Texture* textures, size_t textureCount)
+{
+    PROFILE_ZONE("Model::processMesh");
+
+    // Вершины и индексы уже упакованы в фоновом потоке; здесь они только копируются в отображенную память буферов
+    const float* vertices = m_source.vertices.data() + range.firstFloat;
+    const size_t floatCount = range.vertexCount * vertexStride(m_source.vertexStreams);
+    auto writeVertices = [vertices, floatCount](float* out) {
+        std::copy(vertices, vertices + floatCount, out);
+    };
 
-    // 4. Карты высот
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-    textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+    const unsigned int* indices = m_source.indices.data() + range.firstIndex;
+    const size_t indexCount = range.indexCount;
+    auto writeIndices = [indices, indexCount](unsigned int* out) {
+        std::copy(indices, indices + indexCount, out);
+    };
 
     // Возвращаем меш-объект, созданный на основе полученных данных
-    return new Mesh(vertices, indices, textures);
+    return Mesh(m_source.vertexStreams, range.vertexCount, indexCount, writeVertices, writeIndices, textures, textureCount, m_profile.keepGeometry);
 }
 
 
 
-vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
+void Model::createPlaceholder()
 {
-    vector<Texture> textures;
-    for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    // Серая текстура 1x1 в диффузном слоте: заглушка рисуется теми же вариантами шейдера, что и большинство моделей
+    Texture texture = { 0, TEXTURE_SLOT_DIFFUSE, GpuMemory::NO_RESOURCE };
+    size_t textureCount = 0;
+    if (m_profile.wants(TEXTURE_SLOT_DIFFUSE))
     {
-        aiString str;
-        mat->GetTexture(type, i, &str);
+        DecodedImage grey;
+        grey.width = grey.height = 1;
+        grey.components = 3;
+        grey.pixels.reset(static_cast<unsigned char*>(std::malloc(3)));
+        std::fill(grey.pixels.get(), grey.pixels.get() + 3, static_cast<unsigned char>(128));
+        m_placeholderTexture = uploadTexture(grey);
+        texture.id = m_placeholderTexture;
+        textureCount = 1;
+    }
+
+    // Сфера единичного радиуса: кольца от северного полюса к южному, на каждом PLACEHOLDER_SEGMENTS + 1 вершин
+    // (шов дублируется ради текстурных координат)
+    const unsigned int streams = m_profile.vertexStreams;
+    const size_t columns = PLACEHOLDER_SEGMENTS + 1;
+    const size_t vertexCount = columns * (PLACEHOLDER_RINGS + 1);
+    const size_t indexCount = PLACEHOLDER_SEGMENTS * PLACEHOLDER_RINGS * 6;
+
+    auto writeVertices = [streams](float* out) {
+        const float pi = 3.14159265358979f;
+        for (unsigned int ring = 0; ring <= PLACEHOLDER_RINGS; ring++)
+        {
+            float v = static_cast<float>(ring) / PLACEHOLDER_RINGS;
+            float theta = v * pi;
+            for (unsigned int segment = 0; segment <= PLACEHOLDER_SEGMENTS; segment++)
+            {
+                float u = static_cast<float>(segment) / PLACEHOLDER_SEGMENTS;
+                float phi = u * 2.0f * pi;
+                glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+                glm::vec3 tangent(-std::sin(phi), 0.0f, std::cos(phi));
+                glm::vec3 bitangent = glm::cross(position, tangent);
+
+                auto append = [&out](const glm::vec3& value) {
+                    *out++ = value.x;
+                    *out++ = value.y;
+                    *out++ = value.z;
+                };
+                append(position);
+                if (streams & VERTEX_NORMAL)
+                    append(position);
+                if (streams & VERTEX_TEXCOORDS)
+                {
+                    *out++ = u;
+                    *out++ = v;
+                }
+                if (streams & VERTEX_TANGENT)
+                    append(tangent);
+                if (streams & VERTEX_BITANGENT)
+                    append(bitangent);
+            }
+        }
+    };
 
-        // Проверяем, не была ли текстура загружена ранее, и если - да, то пропускаем загрузку новой текстуры и переходим к следующей итерации
-        bool skip = false;
-        for(unsigned int j = 0; j < m_texturesLoaded.size(); j++)
+    auto writeIndices = [columns](unsigned int* out) {
+        for (unsigned int ring = 0; ring < PLACEHOLDER_RINGS; ring++)
         {
-            if(std::strcmp(m_texturesLoaded[j].path.data(), str.C_Str()) == 0)
+            for (unsigned int segment = 0; segment < PLACEHOLDER_SEGMENTS; segment++)
             {
-                textures.push_back(m_texturesLoaded[j]);
-                skip = true; // текстура с тем же путем к файлу уже загружена, переходим к следующей (оптимизация)
-                break;
+                unsigned int a = static_cast<unsigned int>(ring * columns + segment);
+                unsigned int b = static_cast<unsigned int>(a + columns);
+                *out++ = a;     *out++ = b;     *out++ = a + 1;
+                *out++ = a + 1; *out++ = b;     *out++ = b + 1;
             }
         }
-        if(!skip)
-        {   // если текстура еще не была загружена, то загружаем её
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->m_directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            // сохраняем текстуру в массиве с уже загруженными текстурами,
-            // тем самым гарантируя, что у нас не появятся без необходимости дубликаты текстур.
-            m_texturesLoaded.push_back(texture);
+    };
+
+    m_placeholder.push_back(Mesh(streams, vertexCount, indexCount, writeVertices, writeIndices, &texture, textureCount));
+}
+
+
+
+void Model::restoreTextures()
+{
+    if (m_restore.valid())
+    {
+        if (m_restore.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+        DecodedImage image = m_restore.get();
+        const Texture& texture = m_images[m_restoreImage];
+        // Файл не прочитался: текстура остается уменьшенной, а ее текущий размер GpuMemory считает полным
+        if (image.pixels)
+            fillTexture(texture.id, image);
+        GpuMemory::refresh(texture.resource);
+        return;
+    }
+
+    for (size_t i = 0; i < m_images.size(); i++)
+    {
+        if (GpuMemory::restoreRequested(m_images[i].resource))
+        {
+            m_restoreImage = i;
+            m_restore = std::async(std::launch::async, ModelImport::decodeImage, m_imagePaths[i], m_directory);
+            return;
         }
     }
-    return textures;
 }
 
 
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+TextureHandle TextureFromFile(const char* path, const string& directory, bool gamma)
 {
+    PROFILE_ZONE("TextureFromFile");
+
     static_cast<void>(gamma);
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    return uploadTexture(ModelImport::decodeImage(path, directory));
+}
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+TextureHandle uploadTexture(const DecodedImage& image)
+{
+    PROFILE_ZONE("uploadTexture");
 
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    TextureHandle textureID = TextureHandle::create();
+    if (image.pixels)
+        fillTexture(textureID, image);
 
     return textureID;
 }
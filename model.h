@@ -11,79 +11,161 @@
 #include <Assimp/postprocess.h>
 
 #include "Mesh.hpp"
+#include "glresource.h"
+#include "gpumemory.h"
+#include "importprofile.h"
+#include "modelimport.h"
 #include "shader.h"
+#include "shadervariants.h"
 
 #include <string>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <map>
 #include <vector>
 
 
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+TextureHandle TextureFromFile(const char *path, const string &directory, bool gamma = false);
+
+// Создаем текстуру с мипмапом из декодированного изображения (при пустом изображении - текстура без данных)
+TextureHandle uploadTexture(const DecodedImage& image);
 
 class Model 
 {
 public:
+    // Как конструктор загружает модель
+    enum class Loading
+    {
+        Blocking,   // Импорт и загрузка в GPU прямо в конструкторе
+        Async       // Импорт и декодирование текстур в фоновом потоке, загрузка в GPU порциями в update()
+    };
+
+    // Сколько байт вершин, индексов и текселей update() отправляет в GPU за один вызов (не меньше одного объекта)
+    static const size_t UPLOAD_BYTES_PER_UPDATE = 16 * 1024 * 1024;
+
     /**
      * @brief Model - Конструктор в качестве аргумента использует путь к 3D-модели.
      * @param path - Передаваемый путь к модели.
+     * @param profile - Какие вершинные потоки и текстуры загружать (по умолчанию все, см. ShaderVariants::importProfile).
      * @param gamma - значение наличия гамма коррекции (по умолчанию false).
      */
-    Model(string const &path, bool gamma = false);
+    Model(string const &path, const ImportProfile& profile = ImportProfile::all(), bool gamma = false);
+
+    /**
+     * @brief Model - Конструктор с выбором способа загрузки. При Loading::Async возвращается сразу: пока модель
+     * не готова, вместо нее рисуется заглушка - серая сфера единичного радиуса.
+     */
+    Model(string const &path, const ImportProfile& profile, Loading loading, bool gamma = false);
+
+    /**
+     * @brief Model - Конструктор из уже начатого чтения файла (см. SceneLoader). Загружается как при Loading::Async:
+     * постобработка под profile и декодирование текстур идут в фоне, пока рисуется заглушка.
+     * @param scene - Результат ModelImport::read.
+     * @param profile - Профиль импорта. Может стать известен позже (например, когда соберутся шейдеры): фоновый поток
+     * дождется его после чтения файла. Должен быть задан до finishLoading и до разрушения модели.
+     * @param workers - Потоки для упаковки мешей (nullptr - в фоновом потоке модели); должны пережить Model.
+     */
+    Model(future<ModelSource> scene, shared_future<ImportProfile> profile, ThreadPool* workers = nullptr, bool gamma = false);
 
     ~Model();
 
+    /**
+     * @brief update - Продвигаем асинхронную загрузку: если фоновый импорт завершен, отправляем в GPU очередную
+     * порцию данных. У готовой модели - возвращаем полный размер текстурам, уменьшенным GpuMemory, когда бюджет
+     * это позволяет. Не ждет фоновый поток. Вызывается в потоке GL-контекста, например раз в кадр.
+     * @return true, если модель стала готовой именно в этом вызове (пора подготовить варианты шейдера ее материалов).
+     */
+    bool update(size_t uploadBytes = UPLOAD_BYTES_PER_UPDATE);
+
+    // Дожидаемся фонового импорта и загружаем все оставшееся. Возвращает то же, что update
+    bool finishLoading();
+
+    // Загружены ли все меши и текстуры (модель с ошибкой импорта тоже считается загруженной, у нее просто нет мешей)
+    bool isReady() const;
+
     /**
      * @brief Draw - Отрисовываем модель, а значит и все её меши.
      * @param shader - Объект шейдера для использования.
      */
     void Draw(Shader& shader);
-    
-private:
+
     /**
-     * @brief loadModel - Загружаем модель с помощью Assimp и сохраняем полученные меши в векторе meshes.
-     * @param path - Путь до модели.
+     * @brief Draw - Отрисовываем модель вариантами шейдера. Каждый меш рисуется программой с флагами features
+     * и флагами своего материала; меши сгруппированы по вариантам, поэтому программа меняется минимальное число раз.
+     * @param variants - Набор вариантов шейдера.
+     * @param features - Базовые флаги ShaderFeature (например, UNLIT).
+     * @param bind - Вызывается после каждой смены программы, чтобы установить uniform-переменные.
      */
-    void loadModel(string const &path);
+    void Draw(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind);
 
     /**
-     * @brief processNode -  Рекурсивная обработка узла. Обрабатываем каждый отдельный меш,
-     * расположенный в узле, и повторяем этот процесс для своих дочерних углов (если таковы вообще имеются).
-     * @param node - Текущий узел.
-     * @param scene - Текущая сцена.
+     * @brief DrawInstanced - То же, что Draw, но count экземпляров с матрицами из instanceBuffer (добавляет флаг INSTANCED).
      */
-    void processNode(aiNode *node, const aiScene *scene);
+    void DrawInstanced(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind,
+                       unsigned int instanceBuffer, GLsizei count);
 
     /**
-     * @brief processMesh
-     * @param mesh
-     * @param scene
-     * @return
+     * @brief variantKeys - Нормализованные ключи всех вариантов, которые понадобятся модели при базовых флагах features
+     * (пока модель загружается - варианты заглушки).
      */
-    Mesh* processMesh(aiMesh *mesh, const aiScene *scene);
+    vector<unsigned int> variantKeys(unsigned int features) const;
+    
+private:
+    // Меши, которые сейчас рисуются: загруженные или заглушка
+    vector<Mesh>& drawnMeshes();
+    const vector<Mesh>& drawnMeshes() const;
+
+    void drawVariants(ShaderVariants& variants, unsigned int features, const std::function<void(const Shader&)>& bind,
+                      unsigned int instanceBuffer, GLsizei count);
+
+    // Принимаем результат импорта: дальше его данные загружаются в GPU в uploadStep
+    void receiveSource(ModelSource source);
+
+    // Загружаем в GPU изображения и меши источника, пока не исчерпан бюджет uploadBytes. true - загружено все
+    bool uploadStep(size_t uploadBytes);
 
     /**
-     * @brief loadMaterialTextures - Проверяем все текстуры материалов заданного типа и загружам текстуры,
-     * если они еще не были загружены. Необходимая информация возвращается в виде структуры Texture.
-     * @param mat
-     * @param type
-     * @param typeName
-     * @return
+     * @brief processMesh - Создаем меш из упакованных вершин и индексов источника: они копируются прямо в память буферов.
+     * @param textures - textureCount текстур материала меша.
      */
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName);
+    Mesh processMesh(const MeshRange& range, const Texture* textures, size_t textureCount);
+
+    // Сфера-заглушка с серым материалом, потоки вершины - по профилю импорта
+    void createPlaceholder();
+
+    // Текстура, которую GpuMemory просит вернуть в полный размер, заново декодируется в фоне и загружается в то же имя
+    void restoreTextures();
 
 private:
     // Данные модели
-    vector<Texture>     m_texturesLoaded;   // (оптимизация) сохраняем все загруженные текстуры, чтобы убедиться, что они не загружены более одного раза
-    vector<Mesh*>       m_meshes;
-    string              m_directory;
+    vector<Mesh>        m_meshes;           // Меши модели подряд в одном массиве
+    ImportProfile       m_profile;
     bool                m_gammaCorrection;
 
+    // Загрузка
+    future<ModelSource>     m_import;       // Фоновый импорт (Loading::Async), пока источник не получен
+    shared_future<ImportProfile> m_pendingProfile; // Профиль, который фоновый импорт ждет после чтения файла (до него m_profile - all())
+    ModelSource             m_source;       // Источник, данные которого еще загружаются в GPU
+    size_t                  m_nextImage = 0;
+    size_t                  m_nextMesh = 0;
+    bool                    m_ready = false;
+
+    vector<Texture>         m_images;       // Загруженные изображения источника (id и учет в GpuMemory), по индексу изображения
+    vector<TextureHandle>   m_textures;     // Владение текстурами из m_images
+    vector<string>          m_imagePaths;   // Файлы изображений (относительно m_directory) для восстановления текстур
+    string                  m_directory;
+
+    future<DecodedImage>    m_restore;      // Декодирование восстанавливаемой текстуры
+    size_t                  m_restoreImage = 0;
+
+    vector<Mesh>            m_placeholder;  // Сфера-заглушка, пока модель не готова
+    TextureHandle           m_placeholderTexture;
 };
 
 #endif
-
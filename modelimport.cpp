@@ -0,0 +1,376 @@
+#include "modelimport.h"
+#include "assetpack.h"
+#include "cpuprofiler.h"
+#include "packiosystem.h"
+
+#include <Assimp/postprocess.h>
+
+#include "STB/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iostream>
+#include <map>
+
+namespace
+{
+    // Меши узла и его потомков в порядке обхода
+    void gatherMeshes(const aiNode* node, const aiScene* scene, std::vector<const aiMesh*>& meshes)
+    {
+        // Узел содержит только индексы объектов в сцене.
+        // Сцена же содержит все данные; узел - это лишь способ организации данных
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            gatherMeshes(node->mChildren[i], scene, meshes);
+    }
+
+    // Упаковываем один поток вершин: массив aiMesh читается подряд, запись идет с шагом вершины stride.
+    // Внутри цикла нет ветвлений по потокам, поэтому компилятор разворачивает и векторизует его.
+    // Поток, которого нет в файле (например, касательных у меша без текстурных координат), заполняется нулями,
+    // чтобы не сбить упаковку
+    template <unsigned int COMPONENTS>
+    void packStream(const aiVector3D* source, unsigned int count, float* out, unsigned int stride)
+    {
+        if (source == nullptr)
+        {
+            for (unsigned int i = 0; i < count; i++, out += stride)
+                std::fill(out, out + COMPONENTS, 0.0f);
+            return;
+        }
+        for (unsigned int i = 0; i < count; i++, out += stride)
+        {
+            out[0] = source[i].x;
+            out[1] = source[i].y;
+            if (COMPONENTS == 3)
+                out[2] = source[i].z;
+        }
+    }
+
+    // Переупаковываем вершины меша в потоки streams и собираем индексы всех граней подряд
+    void convertMesh(const aiMesh* mesh, unsigned int streams, float* vertices, unsigned int* indices)
+    {
+        const unsigned int stride = vertexStride(streams);
+        const unsigned int count = mesh->mNumVertices;
+
+        // Координаты
+        packStream<3>(mesh->mVertices, count, vertices, stride);
+        vertices += 3;
+
+        // Нормали
+        if (streams & VERTEX_NORMAL)
+        {
+            packStream<3>(mesh->mNormals, count, vertices, stride);
+            vertices += 3;
+        }
+
+        // Текстурные координаты. Вершина может содержать до 8 различных текстурных координат. Мы предполагаем, что мы не будем
+        // использовать модели, в которых вершина может содержать несколько текстурных координат, поэтому мы всегда берем первый набор (0)
+        if (streams & VERTEX_TEXCOORDS)
+        {
+            packStream<2>(mesh->mTextureCoords[0], count, vertices, stride);
+            vertices += 2;
+        }
+
+        // Касательный вектор
+        if (streams & VERTEX_TANGENT)
+        {
+            packStream<3>(mesh->mTangents, count, vertices, stride);
+            vertices += 3;
+        }
+
+        // Вектор бинормали
+        if (streams & VERTEX_BITANGENT)
+            packStream<3>(mesh->mBitangents, count, vertices, stride);
+
+        // Теперь проходимся по каждой грани меша (грань - это треугольник меша) и извлекаем соответствующие индексы вершин
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            indices = std::copy(face.mIndices, face.mIndices + face.mNumIndices, indices);
+        }
+    }
+
+    // Типы текстур Assimp, из которых берутся слоты материала
+    const aiTextureType SLOT_TEXTURE_TYPES[TEXTURE_SLOT_COUNT] = {
+        aiTextureType_DIFFUSE,      // TEXTURE_SLOT_DIFFUSE
+        aiTextureType_SPECULAR,     // TEXTURE_SLOT_SPECULAR
+        aiTextureType_HEIGHT,       // TEXTURE_SLOT_NORMAL (OBJ хранит карту нормалей в map_Bump)
+        aiTextureType_AMBIENT       // TEXTURE_SLOT_HEIGHT
+    };
+
+    std::atomic<bool> g_fastObj(true);
+
+    bool isObjFile(const std::string& path)
+    {
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || path.size() - dot != 4)
+            return false;
+        std::string extension = path.substr(dot + 1);
+        for (char& c : extension)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return extension == "obj";
+    }
+
+    // Текстура меша: файл, на который ссылаются несколько материалов или слотов, декодируется один раз
+    void addTexture(ModelSource& source, std::map<std::string, unsigned int>& imageIndices, unsigned int slot, const std::string& path)
+    {
+        auto found = imageIndices.find(path);
+        if (found == imageIndices.end())
+        {
+            found = imageIndices.emplace(path, static_cast<unsigned int>(source.images.size())).first;
+            source.images.push_back(ModelImport::decodeImage(path, source.directory));
+        }
+        source.textures.push_back(MeshTextureRef{ static_cast<TextureSlot>(slot), found->second });
+    }
+
+    // Упаковка модели, прочитанной ObjLoader: те же массивы и текстуры мешей, что и из сцены Assimp
+    void prepareObj(ModelSource& source, const ImportProfile& profile, ThreadPool* workers)
+    {
+        const ObjModel& model = *source.obj;
+        std::vector<const ObjMesh*> meshes = ObjLoader::pack(model, profile.vertexStreams, source, workers);
+
+        std::map<std::string, unsigned int> imageIndices;
+        source.textureOffsets.reserve(meshes.size() + 1);
+        for (const ObjMesh* mesh : meshes)
+        {
+            source.textureOffsets.push_back(source.textures.size());
+            if (mesh->materialIndex < 0)
+                continue;
+            const ObjMaterial& material = model.materials[mesh->materialIndex];
+            for (unsigned int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+            {
+                if (!profile.wants(static_cast<TextureSlot>(slot)))
+                    continue;
+                for (const std::string& path : material.textures[slot])
+                    addTexture(source, imageIndices, slot, path);
+            }
+        }
+        source.textureOffsets.push_back(source.textures.size());
+        source.obj.reset();
+    }
+}
+
+
+
+void DecodedImage::Free::operator()(unsigned char* pixels) const
+{
+    stbi_image_free(pixels);
+}
+
+
+
+unsigned int ModelImport::postProcessFlags(const ImportProfile& profile)
+{
+    // Постобработку, результат которой не прочитает шейдер, не запрашиваем: расчет касательных - самый дорогой из шагов
+    unsigned int flags = aiProcess_Triangulate;
+    if (profile.vertexStreams & VERTEX_TEXCOORDS)
+        flags |= aiProcess_FlipUVs;
+    if (profile.vertexStreams & (VERTEX_TANGENT | VERTEX_BITANGENT))
+        flags |= aiProcess_CalcTangentSpace;
+    return flags;
+}
+
+
+
+ModelSource ModelImport::load(const std::string& path, const ImportProfile& profile, ThreadPool* workers)
+{
+    PROFILE_ZONE("ModelImport::load");
+
+    ModelSource source = read(path, postProcessFlags(profile), workers);
+    prepare(source, profile, workers);
+    return source;
+}
+
+
+
+ModelSource ModelImport::read(const std::string& path, unsigned int flags, ThreadPool* workers)
+{
+    if (fastObj() && isObjFile(path))
+        return readObj(path, workers);
+    return readAssimp(path, flags);
+}
+
+
+
+ModelSource ModelImport::readAssimp(const std::string& path, unsigned int flags)
+{
+    PROFILE_ZONE("ModelImport::readAssimp");
+
+    ModelSource source;
+    source.importer.reset(new Assimp::Importer());
+    // Модель и ее материалы читаются из подключенного пакета ресурсов, если они в нем есть
+    if (const AssetPack* pack = AssetPack::mounted())
+        source.importer->SetIOHandler(new PackIOSystem(*pack));
+    const aiScene* scene = nullptr;
+    {
+        PROFILE_ZONE("Assimp::ReadFile");
+        scene = source.importer->ReadFile(path, flags);
+    }
+
+    // Проверка на ошибки
+    if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // если НЕ 0
+    {
+        std::cout << "ERROR::ASSIMP:: " << source.importer->GetErrorString() << std::endl;
+        source.importer.reset();
+        return source;
+    }
+    source.scene = scene;
+    source.postProcessing = flags;
+
+    // Получение пути к файлу
+    source.directory = path.substr(0, path.find_last_of('/'));
+    return source;
+}
+
+
+
+ModelSource ModelImport::readObj(const std::string& path, ThreadPool* workers)
+{
+    PROFILE_ZONE("ModelImport::readObj");
+
+    ModelSource source;
+    std::shared_ptr<ObjModel> model = std::make_shared<ObjModel>();
+    if (!ObjLoader::load(path, *model, workers))
+        return source;
+    source.obj = std::move(model);
+    source.directory = path.substr(0, path.find_last_of('/'));
+    return source;
+}
+
+
+
+void ModelImport::setFastObj(bool enabled)
+{
+    g_fastObj = enabled;
+}
+
+
+
+bool ModelImport::fastObj()
+{
+    return g_fastObj;
+}
+
+
+
+void ModelImport::prepare(ModelSource& source, const ImportProfile& profile, ThreadPool* workers)
+{
+    PROFILE_ZONE("ModelImport::prepare");
+
+    if (!source.valid())
+        return;
+    if (source.obj)
+    {
+        prepareObj(source, profile, workers);
+        return;
+    }
+
+    // Шаги, которых не было при чтении файла (например, касательные, если модель читали до того, как стал известен профиль)
+    unsigned int remaining = postProcessFlags(profile) & ~source.postProcessing;
+    if (remaining != 0)
+    {
+        PROFILE_ZONE("Assimp::ApplyPostProcessing");
+        const aiScene* scene = source.importer->ApplyPostProcessing(remaining);
+        if (scene == nullptr)
+        {
+            std::cout << "ERROR::ASSIMP:: " << source.importer->GetErrorString() << std::endl;
+            source.scene = nullptr;
+            source.importer.reset();
+            return;
+        }
+        source.scene = scene;
+        source.postProcessing |= remaining;
+    }
+    const aiScene* scene = source.scene;
+
+    std::vector<const aiMesh*> meshes;
+    gatherMeshes(scene->mRootNode, scene, meshes);
+
+    // Вершина содержит только потоки из профиля импорта. Места мешей в общих массивах считаются заранее по порядку,
+    // поэтому результат не зависит от того, как меши распределятся по потокам
+    const unsigned int streams = profile.vertexStreams;
+    const size_t stride = vertexStride(streams);
+    source.vertexStreams = streams;
+    source.meshes.resize(meshes.size());
+    size_t floatCount = 0, indexCount = 0;
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        MeshRange& range = source.meshes[i];
+        range.firstFloat = floatCount;
+        range.vertexCount = meshes[i]->mNumVertices;
+        range.firstIndex = indexCount;
+        for (unsigned int face = 0; face < meshes[i]->mNumFaces; face++)
+            range.indexCount += meshes[i]->mFaces[face].mNumIndices;
+        floatCount += range.vertexCount * stride;
+        indexCount += range.indexCount;
+    }
+    source.vertices.resize(floatCount);
+    source.indices.resize(indexCount);
+    {
+        PROFILE_ZONE("ModelImport::convertMeshes");
+        auto convert = [&source, &meshes, streams](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                const MeshRange& range = source.meshes[i];
+                convertMesh(meshes[i], streams, source.vertices.data() + range.firstFloat, source.indices.data() + range.firstIndex);
+            }
+        };
+        if (workers == nullptr)
+            convert(0, meshes.size());
+        else
+            workers->parallelFor(meshes.size(), 1, convert);
+    }
+
+    // Мы вводим соглашение об именах сэмплеров в шейдерах. Каждая диффузная текстура будет называться 'texture_diffuseN',
+    // где N - порядковый номер от 1 до MAX_TEXTURES_PER_SLOT. Текстуры, для которых у шейдера нет сэмплера, не декодируются вовсе.
+    // Файл, на который ссылаются несколько материалов или слотов, декодируется один раз
+    std::map<std::string, unsigned int> imageIndices;
+    source.textureOffsets.reserve(meshes.size() + 1);
+    for (const aiMesh* mesh : meshes)
+    {
+        source.textureOffsets.push_back(source.textures.size());
+        const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+        for (unsigned int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
+        {
+            if (!profile.wants(static_cast<TextureSlot>(slot)))
+                continue;
+            aiTextureType type = SLOT_TEXTURE_TYPES[slot];
+            for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+            {
+                aiString str;
+                material->GetTexture(type, i, &str);
+                addTexture(source, imageIndices, slot, str.C_Str());
+            }
+        }
+    }
+    source.textureOffsets.push_back(source.textures.size());
+
+    // Все нужное из сцены упаковано, Assimp больше не нужен
+    source.scene = nullptr;
+    source.importer.reset();
+}
+
+
+
+DecodedImage ModelImport::decodeImage(const std::string& path, const std::string& directory)
+{
+    PROFILE_ZONE("stbi_load");
+
+    DecodedImage image;
+    image.path = path;
+    std::string filename = directory + '/' + path;
+    const AssetPack* pack = AssetPack::mounted();
+    AssetPack::Data data;
+    if (pack != nullptr && pack->read(filename, data))
+        image.pixels.reset(stbi_load_from_memory(data.data, static_cast<int>(data.size), &image.width, &image.height, &image.components, 0));
+    else
+        image.pixels.reset(stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0));
+    if (!image.pixels)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        image.width = image.height = image.components = 0;
+    }
+    return image;
+}
@@ -0,0 +1,124 @@
+#ifndef MODEL_IMPORT_H
+#define MODEL_IMPORT_H
+
+#include <Assimp/Importer.hpp>
+#include <Assimp/postprocess.h>
+#include <Assimp/scene.h>
+
+#include "Texture.hpp"
+#include "importprofile.h"
+#include "objloader.h"
+#include "threadpool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Изображение текстуры, декодированное stb_image в память процесса
+struct DecodedImage
+{
+    struct Free
+    {
+        void operator()(unsigned char* pixels) const;
+    };
+
+    std::string                             path;       // Путь из материала (относительно каталога модели)
+    int                                     width = 0;
+    int                                     height = 0;
+    int                                     components = 0;
+    std::unique_ptr<unsigned char[], Free>  pixels;     // nullptr - файл не прочитан
+
+    size_t bytes() const { return static_cast<size_t>(width) * static_cast<size_t>(height) * static_cast<size_t>(components); }
+};
+
+// Текстура меша: слот материала и индекс изображения в ModelSource::images
+struct MeshTextureRef
+{
+    TextureSlot     slot;
+    unsigned int    image;
+};
+
+// Меш в общих массивах ModelSource: вершины с vertices[firstFloat], индексы (от 0 внутри меша) с indices[firstIndex]
+struct MeshRange
+{
+    size_t  firstFloat = 0;
+    size_t  vertexCount = 0;
+    size_t  firstIndex = 0;
+    size_t  indexCount = 0;
+};
+
+/**
+ * @brief ModelSource - Результат CPU-части загрузки модели. После read - сцена Assimp (живет, пока жив ее Importer)
+ * или, для OBJ, прочитанная ObjLoader модель;
+ * после prepare сцена освобождена, а остаются упакованные вершины и индексы мешей в порядке обхода узлов,
+ * текстуры каждого меша и декодированные изображения (каждый файл - один раз).
+ * Не содержит GL-объектов, поэтому строится в любом потоке; буферы и текстуры из него создает Model в потоке контекста.
+ */
+struct ModelSource
+{
+    std::unique_ptr<Assimp::Importer>   importer;
+    const aiScene*                      scene = nullptr;
+    std::shared_ptr<ObjModel>           obj;                // Модель OBJ, прочитанная без Assimp (тогда scene нет)
+    unsigned int                        postProcessing = 0; // Шаги постобработки Assimp, уже примененные к scene
+    std::string                         directory;          // Каталог файла модели, от него отсчитываются пути текстур
+
+    unsigned int                        vertexStreams = 0;  // Потоки вершины в vertices (см. VertexStream)
+    std::vector<MeshRange>              meshes;
+    std::vector<float>                  vertices;
+    std::vector<unsigned int>           indices;
+    std::vector<size_t>                 textureOffsets;     // Текстуры меша i - textures[textureOffsets[i] .. textureOffsets[i + 1])
+    std::vector<MeshTextureRef>         textures;
+    std::vector<DecodedImage>           images;
+
+    // Сцена (или модель OBJ) прочитана и еще не обработана prepare
+    bool valid() const { return scene != nullptr || obj != nullptr; }
+};
+
+namespace ModelImport
+{
+    /**
+     * @brief postProcessFlags - Шаги постобработки Assimp, результат которых прочитает шейдер с таким профилем.
+     */
+    unsigned int postProcessFlags(const ImportProfile& profile);
+
+    /**
+     * @brief load - Импортируем файл модели и декодируем текстуры, нужные профилю. Не использует GL и может
+     * выполняться в любом потоке (у каждого вызова свой Assimp::Importer).
+     * @return - Источник модели; при ошибке импорта в нем нет мешей.
+     */
+    ModelSource load(const std::string& path, const ImportProfile& profile, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief read - Первая половина load, которой не нужен профиль: чтение файла с постобработкой flags.
+     * Файлы .obj, пока включен fastObj, читает ObjLoader (порции файла параллельно на workers), и flags к ним не относятся.
+     * Меши и изображения источника остаются пустыми до prepare.
+     */
+    ModelSource read(const std::string& path, unsigned int flags = aiProcess_Triangulate, ThreadPool* workers = nullptr);
+
+    // Чтение файла через Assimp, независимо от его формата
+    ModelSource readAssimp(const std::string& path, unsigned int flags = aiProcess_Triangulate);
+
+    // Чтение файла Wavefront OBJ через ObjLoader
+    ModelSource readObj(const std::string& path, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief setFastObj - Читать ли .obj собственным параллельным загрузчиком (по умолчанию да) или через Assimp.
+     * Вызывается при запуске, до загрузки моделей.
+     */
+    void setFastObj(bool enabled);
+    bool fastObj();
+
+    /**
+     * @brief prepare - Вторая половина load: недостающая для профиля постобработка, упаковка вершин и индексов
+     * мешей и декодирование текстур. Сцена Assimp после этого освобождается.
+     * @param workers - Потоки для упаковки мешей (nullptr - в вызывающем потоке).
+     */
+    void prepare(ModelSource& source, const ImportProfile& profile, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief decodeImage - Читаем и декодируем файл изображения directory/path.
+     */
+    DecodedImage decodeImage(const std::string& path, const std::string& directory);
+}
+
+#endif // MODEL_IMPORT_H
@@ -0,0 +1,75 @@
+#include "objbenchmark.h"
+#include "benchmark.h"
+#include "modelimport.h"
+#include "threadpool.h"
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    const int PASSES = 9;
+
+    // Итог одной загрузки: размеры упакованной модели
+    struct LoadResult
+    {
+        size_t  meshes = 0;
+        size_t  vertices = 0;
+        size_t  triangles = 0;
+    };
+
+    LoadResult load(const std::string& path, bool fastObj, ThreadPool& workers)
+    {
+        // Текстуры не декодируются: замеряется только разбор файла и упаковка вершин
+        ImportProfile profile = ImportProfile::all();
+        profile.textures = 0;
+
+        ModelImport::setFastObj(fastObj);
+        ModelSource source = ModelImport::read(path, ModelImport::postProcessFlags(profile), &workers);
+        ModelImport::prepare(source, profile, &workers);
+
+        LoadResult result;
+        result.meshes = source.meshes.size();
+        result.vertices = source.vertices.size() / vertexStride(source.vertexStreams);
+        result.triangles = source.indices.size() / 3;
+        return result;
+    }
+}
+
+
+
+int runObjBenchmark(const std::string& path)
+{
+    ThreadPool workers;
+    const bool fastObj = ModelImport::fastObj();
+    LoadResult assimp = load(path, false, workers);
+    LoadResult objLoader = load(path, true, workers);
+    if (assimp.triangles == 0 || objLoader.triangles == 0)
+    {
+        std::cout << "ERROR::OBJ_BENCHMARK::CAN'T LOAD " << path << std::endl;
+        ModelImport::setFastObj(fastObj);
+        return -1;
+    }
+
+    std::cout << "OBJ benchmark: " << path << ", median of " << PASSES << " passes, "
+              << workers.concurrency() << " threads" << std::endl;
+    std::cout << std::left << std::setw(12) << "path" << std::right << std::setw(12) << "load ms" << std::setw(10) << "meshes"
+              << std::setw(12) << "vertices" << std::setw(12) << "triangles" << std::endl;
+
+    auto report = [](const char* name, double loadMs, const LoadResult& result) {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << loadMs << std::setw(10) << result.meshes
+                  << std::setw(12) << result.vertices << std::setw(12) << result.triangles << std::endl;
+    };
+
+    double assimpMs = Benchmark::measure([&]() { load(path, false, workers); }, PASSES);
+    double objLoaderMs = Benchmark::measure([&]() { load(path, true, workers); }, PASSES);
+    report("assimp", assimpMs, assimp);
+    report("objloader", objLoaderMs, objLoader);
+    std::cout << std::setprecision(2) << "speedup: " << assimpMs / objLoaderMs << "x" << std::endl;
+
+    ModelImport::setFastObj(fastObj);
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef OBJ_BENCHMARK_H
+#define OBJ_BENCHMARK_H
+
+#include <string>
+
+/**
+ * @brief runObjBenchmark - Замер загрузки файла OBJ: чтение и упаковка мешей (ModelImport::read + prepare с полным
+ * профилем, без декодирования текстур) через Assimp и через ObjLoader. Печатаем медиану времени и размеры
+ * упакованных мешей: ObjLoader объединяет одинаковые вершины граней, поэтому вершин у него меньше.
+ * GL-контекст не нужен.
+ * @return - Код возврата процесса (0 при успехе).
+ */
+int runObjBenchmark(const std::string& path);
+
+#endif // OBJ_BENCHMARK_H
@@ -0,0 +1,817 @@
+#include "objloader.h"
+#include "assetpack.h"
+#include "cpuprofiler.h"
+#include "mappedfile.h"
+#include "modelimport.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+namespace
+{
+    // Содержимое файла: из подключенного пакета или отображение файла с диска
+    struct FileView
+    {
+        AssetPack::Data     packData;
+        MappedFile          file;
+        const char*         begin = nullptr;
+        const char*         end = nullptr;
+
+        bool open(const std::string& path)
+        {
+            const AssetPack* pack = AssetPack::mounted();
+            if (pack != nullptr && pack->read(path, packData))
+            {
+                begin = reinterpret_cast<const char*>(packData.data);
+                end = begin + packData.size;
+                return true;
+            }
+            if (!file.open(path))
+                return false;
+            begin = reinterpret_cast<const char*>(file.data());
+            end = begin + file.size();
+            return true;
+        }
+    };
+
+    // Смена группы или материала внутри порции: действует с грани firstFace (номер внутри порции)
+    struct ChunkSegment
+    {
+        std::uint32_t   firstFace = 0;
+        bool            setsName = false;
+        std::string     name;
+        bool            setsMaterial = false;
+        std::string     material;
+    };
+
+    // Результат разбора одной порции файла. Отрицательные (относительные) индексы пересчитываются
+    // от начала порции и помечаются в relative, абсолютные номера им дает слияние
+    struct Chunk
+    {
+        const char*                 begin = nullptr;
+        const char*                 end = nullptr;
+
+        std::vector<float>          positions, texcoords, normals;
+        std::vector<ObjCorner>      corners;
+        std::vector<std::pair<std::uint32_t, std::uint8_t>> relative;  // Вершина грани и маска ее относительных индексов
+        std::vector<std::uint32_t>  faceStarts;
+        std::vector<ChunkSegment>   segments;
+        std::vector<std::string>    materialLibraries;
+        bool                        invalidIndex = false;
+    };
+
+    // Цикл по порциям [0, count) на workers или, без пула, в вызывающем потоке
+    void forEachRange(ThreadPool* workers, size_t count, const ThreadPool::RangeFunction& body)
+    {
+        if (workers == nullptr)
+            body(0, count);
+        else
+            workers->parallelFor(count, 1, body);
+    }
+
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    const char* lineEnd(const char* p, const char* end)
+    {
+        const void* found = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        return found != nullptr ? static_cast<const char*>(found) : end;
+    }
+
+    // Остаток строки без пробелов по краям
+    std::string restOfLine(const char* p, const char* end)
+    {
+        p = skipSpaces(p, end);
+        while (end > p && isSpace(end[-1]))
+            end--;
+        return std::string(p, end);
+    }
+
+    // Ключевое слово keyword в начале строки, за которым пробел или конец строки
+    bool startsWith(const char* p, const char* end, const char* keyword)
+    {
+        size_t length = std::strlen(keyword);
+        if (static_cast<size_t>(end - p) < length || std::memcmp(p, keyword, length) != 0)
+            return false;
+        return p + length == end || isSpace(p[length]);
+    }
+
+    const char* parseInt(const char* p, const char* end, int& value)
+    {
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        long long result = 0;
+        const char* digits = p;
+        while (p < end && *p >= '0' && *p <= '9')
+            result = result * 10 + (*p++ - '0');
+        if (p == digits)
+            return start;
+        value = static_cast<int>(negative ? -result : result);
+        return p;
+    }
+
+    // Индекс вершины грани: от 1 - абсолютный, отрицательный - от конца уже прочитанных, 0 - ошибка
+    std::int32_t resolveIndex(int index, size_t localCount, std::uint8_t bit, std::uint8_t& relativeMask, bool& invalid)
+    {
+        if (index > 0)
+            return index - 1;
+        if (index < 0)
+        {
+            relativeMask |= bit;
+            return static_cast<std::int32_t>(static_cast<long long>(localCount) + index);
+        }
+        invalid = true;
+        return -1;
+    }
+
+    void parseFace(const char* p, const char* end, Chunk& chunk)
+    {
+        const size_t positionCount = chunk.positions.size() / 3;
+        const size_t texcoordCount = chunk.texcoords.size() / 2;
+        const size_t normalCount = chunk.normals.size() / 3;
+
+        chunk.faceStarts.push_back(static_cast<std::uint32_t>(chunk.corners.size()));
+        for (p = skipSpaces(p, end); p < end; p = skipSpaces(p, end))
+        {
+            // v, v/vt, v//vn или v/vt/vn
+            ObjCorner corner = { -1, -1, -1 };
+            std::uint8_t relativeMask = 0;
+            int index = 0;
+            const char* next = parseInt(p, end, index);
+            if (next == p)
+            {
+                chunk.invalidIndex = true;
+                break;
+            }
+            corner.position = resolveIndex(index, positionCount, 1, relativeMask, chunk.invalidIndex);
+            p = next;
+            if (p < end && *p == '/')
+            {
+                p++;
+                next = parseInt(p, end, index);
+                if (next != p)
+                    corner.texcoord = resolveIndex(index, texcoordCount, 2, relativeMask, chunk.invalidIndex);
+                p = next;
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    next = parseInt(p, end, index);
+                    if (next != p)
+                        corner.normal = resolveIndex(index, normalCount, 4, relativeMask, chunk.invalidIndex);
+                    p = next;
+                }
+            }
+            if (relativeMask != 0)
+                chunk.relative.emplace_back(static_cast<std::uint32_t>(chunk.corners.size()), relativeMask);
+            chunk.corners.push_back(corner);
+            while (p < end && !isSpace(*p))
+                p++;
+        }
+    }
+
+    // Читаем до count чисел строки в values; недостающие - нули
+    void parseFloats(const char* p, const char* end, std::vector<float>& values, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            float value = 0.0f;
+            p = skipSpaces(p, end);
+            p = ObjLoader::parseFloat(p, end, value);
+            values.push_back(value);
+        }
+    }
+
+    void parseChunk(Chunk& chunk)
+    {
+        const char* p = chunk.begin;
+        while (p < chunk.end)
+        {
+            const char* end = lineEnd(p, chunk.end);
+            const char* line = skipSpaces(p, end);
+            if (line < end)
+            {
+                if (line[0] == 'v' && line + 1 < end && isSpace(line[1]))
+                    parseFloats(line + 2, end, chunk.positions, 3);
+                else if (startsWith(line, end, "vt"))
+                    parseFloats(line + 3, end, chunk.texcoords, 2);
+                else if (startsWith(line, end, "vn"))
+                    parseFloats(line + 3, end, chunk.normals, 3);
+                else if (line[0] == 'f' && line + 1 < end && isSpace(line[1]))
+                    parseFace(line + 2, end, chunk);
+                else if (startsWith(line, end, "g") || startsWith(line, end, "o"))
+                {
+                    ChunkSegment segment;
+                    segment.firstFace = static_cast<std::uint32_t>(chunk.faceStarts.size());
+                    segment.setsName = true;
+                    segment.name = restOfLine(line + 1, end);
+                    chunk.segments.push_back(std::move(segment));
+                }
+                else if (startsWith(line, end, "usemtl"))
+                {
+                    ChunkSegment segment;
+                    segment.firstFace = static_cast<std::uint32_t>(chunk.faceStarts.size());
+                    segment.setsMaterial = true;
+                    segment.material = restOfLine(line + 6, end);
+                    chunk.segments.push_back(std::move(segment));
+                }
+                else if (startsWith(line, end, "mtllib"))
+                    chunk.materialLibraries.push_back(restOfLine(line + 6, end));
+            }
+            p = end + 1;
+        }
+    }
+
+    const char* tokenEnd(const char* p, const char* end)
+    {
+        while (p < end && !isSpace(*p))
+            p++;
+        return p;
+    }
+
+    // Число - только если parseFloat дочитал токен до конца: "2k_mars.jpg" начинается с цифры, но числом не является
+    bool isNumberToken(const char* p, const char* end)
+    {
+        float number = 0.0f;
+        const char* next = ObjLoader::parseFloat(p, end, number);
+        return next != p && next == tokenEnd(p, end);
+    }
+
+    // Путь текстуры из строки map_*: опции вида "-bm 0.5" пропускаются вместе с аргументами, остаток строки - имя файла.
+    // Число аргументов опции известно (как в импортере MTL Assimp); у -o, -s и -t от одного до трех чисел
+    std::string texturePath(const char* p, const char* end)
+    {
+        struct TextureOption { const char* name; int minArguments; int maxArguments; };
+        const TextureOption OPTIONS[] = {
+            { "-blendu", 1, 1 }, { "-blendv", 1, 1 }, { "-boost", 1, 1 }, { "-cc", 1, 1 }, { "-clamp", 1, 1 },
+            { "-bm", 1, 1 }, { "-imfchan", 1, 1 }, { "-texres", 1, 1 }, { "-type", 1, 1 }, { "-mm", 2, 2 },
+            { "-o", 1, 3 }, { "-s", 1, 3 }, { "-t", 1, 3 }
+        };
+
+        for (p = skipSpaces(p, end); p < end && *p == '-'; p = skipSpaces(p, end))
+        {
+            const char* nameEnd = tokenEnd(p, end);
+            int minArguments = 0, maxArguments = 0;
+            for (const TextureOption& option : OPTIONS)
+            {
+                if (static_cast<size_t>(nameEnd - p) == std::strlen(option.name) && std::memcmp(p, option.name, nameEnd - p) == 0)
+                {
+                    minArguments = option.minArguments;
+                    maxArguments = option.maxArguments;
+                    break;
+                }
+            }
+            p = nameEnd;
+            for (int i = 0; i < maxArguments; i++)
+            {
+                p = skipSpaces(p, end);
+                if (p == end || (i >= minArguments && !isNumberToken(p, end)))
+                    break;
+                p = tokenEnd(p, end);
+            }
+        }
+        return restOfLine(p, end);
+    }
+
+    bool equalsNoCase(const char* p, const char* end, const char* keyword)
+    {
+        size_t length = std::strlen(keyword);
+        if (static_cast<size_t>(end - p) < length || (p + length < end && !isSpace(p[length])))
+            return false;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (std::tolower(static_cast<unsigned char>(p[i])) != keyword[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Материалы библиотеки MTL. Карты, указанные до первого newmtl, как и у Assimp, никому не достаются
+    void parseMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials)
+    {
+        PROFILE_ZONE("ObjLoader::parseMaterialLibrary");
+
+        FileView view;
+        if (!view.open(path))
+        {
+            std::cout << "ERROR::OBJ::CAN'T READ MATERIAL LIBRARY " << path << std::endl;
+            return;
+        }
+
+        // Слоты по типам Assimp: map_Bump (aiTextureType_HEIGHT) - карта нормалей, map_Ka (aiTextureType_AMBIENT) - высот
+        struct MapKeyword { const char* keyword; TextureSlot slot; };
+        const MapKeyword MAPS[] = {
+            { "map_kd", TEXTURE_SLOT_DIFFUSE },
+            { "map_ks", TEXTURE_SLOT_SPECULAR },
+            { "map_bump", TEXTURE_SLOT_NORMAL },
+            { "bump", TEXTURE_SLOT_NORMAL },
+            { "map_ka", TEXTURE_SLOT_HEIGHT }
+        };
+
+        ObjMaterial* current = nullptr;
+        for (const char* p = view.begin; p < view.end; )
+        {
+            const char* end = lineEnd(p, view.end);
+            const char* line = skipSpaces(p, end);
+            if (startsWith(line, end, "newmtl"))
+            {
+                materials.emplace_back();
+                current = &materials.back();
+                current->name = restOfLine(line + 6, end);
+            }
+            else if (current != nullptr)
+            {
+                for (const MapKeyword& map : MAPS)
+                {
+                    if (equalsNoCase(line, end, map.keyword))
+                    {
+                        std::string texture = texturePath(line + std::strlen(map.keyword), end);
+                        if (!texture.empty())
+                            current->textures[map.slot].push_back(texture);
+                        break;
+                    }
+                }
+            }
+            p = end + 1;
+        }
+    }
+
+    // Ключ вершины меша для объединения одинаковых вершин граней
+    struct CornerKey
+    {
+        std::int32_t position, texcoord, normal;
+
+        bool operator==(const CornerKey& other) const
+        {
+            return position == other.position && texcoord == other.texcoord && normal == other.normal;
+        }
+    };
+
+    struct CornerKeyHash
+    {
+        size_t operator()(const CornerKey& key) const
+        {
+            std::uint64_t hash = static_cast<std::uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+            hash ^= (static_cast<std::uint32_t>(key.texcoord) + 0x632BE59BD9B4E019ull + (hash << 6) + (hash >> 2));
+            hash ^= (static_cast<std::uint32_t>(key.normal) + 0x85EBCA77C2B2AE63ull + (hash << 6) + (hash >> 2));
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    // Меш после триангуляции: упакованные вершины и индексы
+    struct PackedMesh
+    {
+        std::vector<float>          vertices;
+        std::vector<unsigned int>   indices;
+    };
+
+    void packMesh(const ObjModel& model, const ObjMesh& mesh, unsigned int streams, PackedMesh& packed)
+    {
+        const unsigned int stride = vertexStride(streams);
+        const bool wantsTangents = (streams & (VERTEX_TANGENT | VERTEX_BITANGENT)) != 0;
+
+        size_t cornerEstimate = 0;
+        for (const auto& range : mesh.faceRanges)
+            cornerEstimate += model.faceStarts[range.second] - model.faceStarts[range.first];
+
+        std::unordered_map<CornerKey, unsigned int, CornerKeyHash> vertexIndices;
+        vertexIndices.reserve(cornerEstimate);
+        std::vector<CornerKey> keys;
+        packed.indices.reserve(cornerEstimate * 3 / 2);
+
+        for (const auto& range : mesh.faceRanges)
+        {
+            for (std::uint32_t face = range.first; face < range.second; face++)
+            {
+                std::uint32_t first = model.faceStarts[face];
+                std::uint32_t count = model.faceStarts[face + 1] - first;
+                // Точки и линии не рисуются треугольниками
+                if (count < 3)
+                    continue;
+
+                unsigned int polygon[3];
+                for (std::uint32_t corner = 0; corner < count; corner++)
+                {
+                    const ObjCorner& source = model.corners[first + corner];
+                    CornerKey key = { source.position, source.texcoord, source.normal };
+                    auto inserted = vertexIndices.emplace(key, static_cast<unsigned int>(keys.size()));
+                    if (inserted.second)
+                        keys.push_back(key);
+                    unsigned int index = inserted.first->second;
+
+                    // Веер: (0, k - 1, k)
+                    if (corner == 0)
+                        polygon[0] = index;
+                    else if (corner == 1)
+                        polygon[1] = index;
+                    else
+                    {
+                        polygon[2] = index;
+                        packed.indices.insert(packed.indices.end(), polygon, polygon + 3);
+                        polygon[1] = index;
+                    }
+                }
+            }
+        }
+        if (packed.indices.empty())
+            return;
+
+        // Касательные копятся по треугольникам вершины, затем ортогонализуются к нормали (как aiProcess_CalcTangentSpace)
+        std::vector<glm::vec3> tangents, bitangents;
+        if (wantsTangents)
+        {
+            tangents.assign(keys.size(), glm::vec3(0.0f));
+            bitangents.assign(keys.size(), glm::vec3(0.0f));
+            for (size_t i = 0; i + 2 < packed.indices.size(); i += 3)
+            {
+                const CornerKey* corners[3];
+                for (int k = 0; k < 3; k++)
+                    corners[k] = &keys[packed.indices[i + k]];
+                if (corners[0]->texcoord < 0 || corners[1]->texcoord < 0 || corners[2]->texcoord < 0)
+                    continue;
+
+                glm::vec3 p[3];
+                glm::vec2 uv[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = glm::vec3(model.positions[corners[k]->position * 3], model.positions[corners[k]->position * 3 + 1],
+                                     model.positions[corners[k]->position * 3 + 2]);
+                    uv[k] = glm::vec2(model.texcoords[corners[k]->texcoord * 2], model.texcoords[corners[k]->texcoord * 2 + 1]);
+                }
+                glm::vec3 edge1 = p[1] - p[0], edge2 = p[2] - p[0];
+                glm::vec2 duv1 = uv[1] - uv[0], duv2 = uv[2] - uv[0];
+                float determinant = duv1.x * duv2.y - duv2.x * duv1.y;
+                if (std::abs(determinant) < 1e-12f)
+                    continue;
+                float inverse = 1.0f / determinant;
+                glm::vec3 tangent = (edge1 * duv2.y - edge2 * duv1.y) * inverse;
+                glm::vec3 bitangent = (edge2 * duv1.x - edge1 * duv2.x) * inverse;
+                for (int k = 0; k < 3; k++)
+                {
+                    tangents[packed.indices[i + k]] += tangent;
+                    bitangents[packed.indices[i + k]] += bitangent;
+                }
+            }
+        }
+
+        auto orthogonal = [](glm::vec3 value, const glm::vec3& normal) {
+            value -= normal * glm::dot(normal, value);
+            float length = glm::length(value);
+            return length > 1e-12f ? value / length : glm::vec3(0.0f);
+        };
+
+        packed.vertices.resize(keys.size() * stride);
+        float* out = packed.vertices.data();
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            const CornerKey& key = keys[i];
+            const float* position = &model.positions[static_cast<size_t>(key.position) * 3];
+            glm::vec3 normal(0.0f);
+            if (key.normal >= 0)
+                normal = glm::vec3(model.normals[key.normal * 3], model.normals[key.normal * 3 + 1], model.normals[key.normal * 3 + 2]);
+
+            out = std::copy(position, position + 3, out);
+            if (streams & VERTEX_NORMAL)
+            {
+                *out++ = normal.x;
+                *out++ = normal.y;
+                *out++ = normal.z;
+            }
+            if (streams & VERTEX_TEXCOORDS)
+            {
+                // Как aiProcess_FlipUVs: начало текстурных координат - верхний левый угол
+                *out++ = key.texcoord >= 0 ? model.texcoords[key.texcoord * 2] : 0.0f;
+                *out++ = key.texcoord >= 0 ? 1.0f - model.texcoords[key.texcoord * 2 + 1] : 0.0f;
+            }
+            if (wantsTangents)
+            {
+                glm::vec3 tangent = key.normal >= 0 ? orthogonal(tangents[i], normal) : glm::vec3(0.0f);
+                glm::vec3 bitangent = key.normal >= 0 ? orthogonal(bitangents[i], normal) : glm::vec3(0.0f);
+                if (streams & VERTEX_TANGENT)
+                {
+                    *out++ = tangent.x;
+                    *out++ = tangent.y;
+                    *out++ = tangent.z;
+                }
+                if (streams & VERTEX_BITANGENT)
+                {
+                    *out++ = bitangent.x;
+                    *out++ = bitangent.y;
+                    *out++ = bitangent.z;
+                }
+            }
+        }
+    }
+}
+
+
+
+const char* ObjLoader::parseFloat(const char* begin, const char* end, float& value)
+{
+    const char* p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    // Первые 19 значащих цифр собираются в целое, остальные только сдвигают порядок
+    std::uint64_t mantissa = 0;
+    int exponent = 0;
+    int significant = 0;
+    bool anyDigits = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        anyDigits = true;
+        if (significant < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            if (mantissa != 0)
+                significant++;
+        }
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            anyDigits = true;
+            if (significant < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                if (mantissa != 0)
+                    significant++;
+                exponent--;
+            }
+        }
+    }
+    if (!anyDigits)
+        return begin;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        int power = 0;
+        const char* next = parseInt(p + 1, end, power);
+        if (next != p + 1)
+        {
+            exponent += power;
+            p = next;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (exponent != 0 && mantissa != 0)
+    {
+        if (exponent > 0 && exponent <= 22)
+            result *= POWERS_OF_TEN[exponent];
+        else if (exponent < 0 && exponent >= -22)
+            result /= POWERS_OF_TEN[-exponent];
+        else
+            result *= std::pow(10.0, exponent);
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+
+
+bool ObjLoader::load(const std::string& path, ObjModel& model, ThreadPool* workers)
+{
+    PROFILE_ZONE("ObjLoader::load");
+
+    FileView view;
+    if (!view.open(path))
+    {
+        std::cout << "ERROR::OBJ::CAN'T READ FILE " << path << std::endl;
+        return false;
+    }
+
+    // Порции по границам строк: каждая, кроме первой, начинается сразу после '\n'. Без пула файл разбирается одной порцией
+    const size_t size = static_cast<size_t>(view.end - view.begin);
+    const size_t concurrency = workers != nullptr ? workers->concurrency() : 0;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(concurrency * 4, size / MIN_CHUNK_BYTES));
+    std::vector<Chunk> chunks(chunkCount);
+    const char* chunkBegin = view.begin;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        const char* chunkEnd = view.end;
+        if (i + 1 < chunkCount)
+        {
+            chunkEnd = std::max(chunkBegin, view.begin + size * (i + 1) / chunkCount);
+            chunkEnd = std::min(lineEnd(chunkEnd, view.end) + 1, view.end);
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    {
+        PROFILE_ZONE("ObjLoader::parseChunks");
+        forEachRange(workers, chunks.size(), [&chunks](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                parseChunk(chunks[i]);
+        });
+    }
+
+    // Места порций в общих массивах
+    struct ChunkBase { size_t positions, texcoords, normals, corners, faces; };
+    std::vector<ChunkBase> bases(chunks.size());
+    ChunkBase total = {};
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        bases[i] = total;
+        total.positions += chunks[i].positions.size();
+        total.texcoords += chunks[i].texcoords.size();
+        total.normals += chunks[i].normals.size();
+        total.corners += chunks[i].corners.size();
+        total.faces += chunks[i].faceStarts.size();
+        if (chunks[i].invalidIndex)
+        {
+            std::cout << "ERROR::OBJ::INVALID FACE " << path << std::endl;
+            return false;
+        }
+    }
+
+    model.positions.resize(total.positions);
+    model.texcoords.resize(total.texcoords);
+    model.normals.resize(total.normals);
+    model.corners.resize(total.corners);
+    model.faceStarts.resize(total.faces + 1);
+    model.faceStarts[total.faces] = static_cast<std::uint32_t>(total.corners);
+
+    std::atomic<bool> outOfRange(false);
+    {
+        PROFILE_ZONE("ObjLoader::mergeChunks");
+        forEachRange(workers, chunks.size(), [&](size_t begin, size_t end) {
+            const std::int32_t positionCount = static_cast<std::int32_t>(total.positions / 3);
+            const std::int32_t texcoordCount = static_cast<std::int32_t>(total.texcoords / 2);
+            const std::int32_t normalCount = static_cast<std::int32_t>(total.normals / 3);
+            for (size_t i = begin; i < end; i++)
+            {
+                const Chunk& chunk = chunks[i];
+                const ChunkBase& base = bases[i];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), model.positions.begin() + base.positions);
+                std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), model.texcoords.begin() + base.texcoords);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), model.normals.begin() + base.normals);
+
+                ObjCorner* corners = model.corners.data() + base.corners;
+                std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+                for (const auto& relative : chunk.relative)
+                {
+                    ObjCorner& corner = corners[relative.first];
+                    if (relative.second & 1)
+                        corner.position += static_cast<std::int32_t>(base.positions / 3);
+                    if (relative.second & 2)
+                        corner.texcoord += static_cast<std::int32_t>(base.texcoords / 2);
+                    if (relative.second & 4)
+                        corner.normal += static_cast<std::int32_t>(base.normals / 3);
+                }
+                for (size_t c = 0; c < chunk.corners.size(); c++)
+                {
+                    const ObjCorner& corner = corners[c];
+                    if (corner.position < 0 || corner.position >= positionCount || corner.texcoord >= texcoordCount
+                        || corner.normal >= normalCount || corner.texcoord < -1 || corner.normal < -1)
+                        outOfRange = true;
+                }
+
+                for (size_t f = 0; f < chunk.faceStarts.size(); f++)
+                    model.faceStarts[base.faces + f] = static_cast<std::uint32_t>(base.corners + chunk.faceStarts[f]);
+            }
+        });
+    }
+    if (outOfRange)
+    {
+        std::cout << "ERROR::OBJ::INDEX OUT OF RANGE " << path << std::endl;
+        return false;
+    }
+
+    // Грани раскладываются по мешам (группа, материал) в порядке первого появления
+    std::map<std::pair<std::string, std::string>, size_t> meshIndices;
+    std::string name, material;
+    std::vector<std::string> libraries;
+    std::uint32_t segmentStart = 0;
+    auto closeSegment = [&](std::uint32_t segmentEnd) {
+        if (segmentEnd <= segmentStart)
+            return;
+        auto found = meshIndices.emplace(std::make_pair(name, material), model.meshes.size());
+        if (found.second)
+        {
+            model.meshes.emplace_back();
+            model.meshes.back().name = name;
+            model.meshes.back().material = material;
+        }
+        auto& ranges = model.meshes[found.first->second].faceRanges;
+        if (!ranges.empty() && ranges.back().second == segmentStart)
+            ranges.back().second = segmentEnd;
+        else
+            ranges.emplace_back(segmentStart, segmentEnd);
+    };
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        for (const ChunkSegment& segment : chunks[i].segments)
+        {
+            std::uint32_t face = static_cast<std::uint32_t>(bases[i].faces + segment.firstFace);
+            closeSegment(face);
+            segmentStart = face;
+            if (segment.setsName)
+                name = segment.name;
+            if (segment.setsMaterial)
+                material = segment.material;
+        }
+        libraries.insert(libraries.end(), chunks[i].materialLibraries.begin(), chunks[i].materialLibraries.end());
+    }
+    closeSegment(static_cast<std::uint32_t>(total.faces));
+
+    // Библиотеки материалов лежат рядом с моделью
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash != std::string::npos ? path.substr(0, slash) : ".";
+    for (const std::string& library : libraries)
+        parseMaterialLibrary(directory + '/' + library, model.materials);
+    for (ObjMesh& mesh : model.meshes)
+    {
+        for (size_t i = 0; i < model.materials.size(); i++)
+        {
+            if (model.materials[i].name == mesh.material)
+            {
+                mesh.materialIndex = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+
+
+std::vector<const ObjMesh*> ObjLoader::pack(const ObjModel& model, unsigned int streams, ModelSource& source, ThreadPool* workers)
+{
+    PROFILE_ZONE("ObjLoader::pack");
+
+    std::vector<PackedMesh> packed(model.meshes.size());
+    forEachRange(workers, model.meshes.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            packMesh(model, model.meshes[i], streams, packed[i]);
+    });
+
+    // Места мешей в общих массивах - по порядку, как у ModelImport::prepare
+    const size_t stride = vertexStride(streams);
+    std::vector<const ObjMesh*> meshes;
+    source.vertexStreams = streams;
+    source.meshes.clear();
+    size_t floatCount = 0, indexCount = 0;
+    for (size_t i = 0; i < packed.size(); i++)
+    {
+        if (packed[i].indices.empty())
+            continue;
+        MeshRange range;
+        range.firstFloat = floatCount;
+        range.vertexCount = packed[i].vertices.size() / stride;
+        range.firstIndex = indexCount;
+        range.indexCount = packed[i].indices.size();
+        floatCount += packed[i].vertices.size();
+        indexCount += range.indexCount;
+        source.meshes.push_back(range);
+        meshes.push_back(&model.meshes[i]);
+    }
+
+    source.vertices.resize(floatCount);
+    source.indices.resize(indexCount);
+    std::vector<size_t> kept;
+    for (size_t i = 0; i < packed.size(); i++)
+    {
+        if (!packed[i].indices.empty())
+            kept.push_back(i);
+    }
+    forEachRange(workers, kept.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const PackedMesh& mesh = packed[kept[i]];
+            const MeshRange& range = source.meshes[i];
+            std::copy(mesh.vertices.begin(), mesh.vertices.end(), source.vertices.begin() + range.firstFloat);
+            std::copy(mesh.indices.begin(), mesh.indices.end(), source.indices.begin() + range.firstIndex);
+        }
+    });
+    return meshes;
+}
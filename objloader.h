@@ -0,0 +1,87 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "Texture.hpp"
+#include "threadpool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ModelSource;
+
+// Вершина грани OBJ: индексы позиции, текстурных координат и нормали от 0; -1 - компоненты нет
+struct ObjCorner
+{
+    std::int32_t    position;
+    std::int32_t    texcoord;
+    std::int32_t    normal;
+};
+
+// Грани одной группы (g/o) с одним материалом - будущий меш
+struct ObjMesh
+{
+    std::string                                     name;
+    std::string                                     material;       // Имя из usemtl
+    int                                             materialIndex = -1; // Индекс в ObjModel::materials; -1 - материала нет
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> faceRanges; // Диапазоны [first, last) граней ObjModel
+};
+
+// Текстуры материала MTL по слотам (пути относительно каталога модели)
+struct ObjMaterial
+{
+    std::string                 name;
+    std::vector<std::string>    textures[TEXTURE_SLOT_COUNT];
+};
+
+/**
+ * @brief ObjModel - Разобранный файл Wavefront OBJ и его библиотеки MTL: общие массивы атрибутов, грани
+ * (вершины граней подряд) и меши в порядке первого появления. От профиля импорта не зависит.
+ */
+struct ObjModel
+{
+    std::vector<float>          positions;      // xyz
+    std::vector<float>          texcoords;      // uv
+    std::vector<float>          normals;        // xyz
+    std::vector<ObjCorner>      corners;
+    std::vector<std::uint32_t>  faceStarts;     // Грань i - corners[faceStarts[i] .. faceStarts[i + 1])
+    std::vector<ObjMesh>        meshes;
+    std::vector<ObjMaterial>    materials;
+};
+
+/**
+ * @brief ObjLoader - Загрузка Wavefront OBJ/MTL без Assimp. Файл отображается в память (или берется из AssetPack)
+ * и делится на порции по границам строк; порции разбираются параллельно и сливаются по порядку, поэтому результат
+ * не зависит от числа потоков. Вершины мешей упаковываются сразу в формат ModelSource.
+ */
+namespace ObjLoader
+{
+    // Порция файла на один поток не меньше: иначе запуск порции дороже ее разбора
+    const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+    /**
+     * @brief load - Читаем OBJ и библиотеки MTL, на которые он ссылается.
+     * @param workers - Потоки для разбора порций файла (nullptr - в вызывающем потоке).
+     * @return false, если файл не прочитан или ссылается на несуществующие вершины (сообщение уже выведено).
+     */
+    bool load(const std::string& path, ObjModel& model, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief pack - Упаковываем меши модели в source: грани триангулируются веером, одинаковые вершины граней
+     * объединяются, касательные (если их просят streams) считаются по треугольникам, текстурные координаты
+     * переворачиваются по v, как aiProcess_FlipUVs. Меши без треугольников пропускаются.
+     * @param workers - Потоки для упаковки мешей (nullptr - в вызывающем потоке).
+     * @return - Меши ObjModel в порядке мешей source.
+     */
+    std::vector<const ObjMesh*> pack(const ObjModel& model, unsigned int streams, ModelSource& source, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief parseFloat - Разбираем десятичное число с плавающей точкой в [begin, end).
+     * @return - Позиция после числа; begin, если числа нет.
+     */
+    const char* parseFloat(const char* begin, const char* end, float& value);
+}
+
+#endif // OBJ_LOADER_H
@@ -0,0 +1,372 @@
+#include "orbitalsystem.h"
+#include "barneshut.h"
+#include "cpuprofiler.h"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const double TWO_PI = 6.283185307179586;
+
+    // Параметры взаимного притяжения: угол раскрытия узлов дерева и квадрат длины сглаживания (0.05 - порядка размера тела)
+    const float NBODY_THETA = 0.7f;
+    const float NBODY_SOFTENING2 = 2.5e-3f;
+
+    // Начальное приближение Данби (E = M + 0.85 e sign(sin M)) сходится методом Ньютона при любом e < 1
+    float keplerInitialGuess(float meanAnomaly, float eccentricity)
+    {
+        const float pi = 3.14159265f;
+        return meanAnomaly + (meanAnomaly <= pi ? 0.85f : -0.85f) * eccentricity;
+    }
+
+#ifdef ONION_SIMD_SSE
+    // sin и cos четырех углов: приведение к [-pi, pi], отражение в [-pi/2, pi/2] и ряды Тейлора
+    // (погрешность ~1e-7, на уровне округления float)
+    void sinCos(__m128 angle, __m128& sine, __m128& cosine)
+    {
+        const __m128 twoPi = _mm_set1_ps(6.28318531f);
+        const __m128 invTwoPi = _mm_set1_ps(0.159154943f);
+        const __m128 pi = _mm_set1_ps(3.14159265f);
+        const __m128 halfPi = _mm_set1_ps(1.57079633f);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        // Прибавление и вычитание 1.5 * 2^23 округляет до целого (|x| < 2^22) без SSE4.1
+        const __m128 roundMagic = _mm_set1_ps(12582912.0f);
+
+        __m128 turns = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(angle, invTwoPi), roundMagic), roundMagic);
+        __m128 x = _mm_sub_ps(angle, _mm_mul_ps(turns, twoPi));
+
+        __m128 sign = _mm_and_ps(x, signMask);
+        __m128 reflect = _mm_cmpgt_ps(_mm_andnot_ps(signMask, x), halfPi);
+        __m128 reflected = _mm_sub_ps(_mm_or_ps(pi, sign), x);
+        x = _mm_or_ps(_mm_and_ps(reflect, reflected), _mm_andnot_ps(reflect, x));
+        __m128 cosineSign = _mm_and_ps(reflect, signMask);
+
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 s = _mm_set1_ps(-2.50521084e-8f);
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.75573192e-6f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.98412698e-4f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(8.33333333e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.66666667e-1f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(1.0f));
+        sine = _mm_mul_ps(s, x);
+
+        __m128 c = _mm_set1_ps(2.08767570e-9f);
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-2.75573192e-7f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.48015873e-5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.38888889e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(4.16666667e-2f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(1.0f));
+        cosine = _mm_xor_ps(c, cosineSign);
+    }
+#endif
+}
+
+
+
+OrbitalSystem::OrbitalSystem(float centralGM) : m_centralGM(centralGM)
+{
+}
+
+
+
+OrbitalSystem::~OrbitalSystem() = default;
+
+
+
+void OrbitalSystem::reserve(size_t count)
+{
+    for (std::vector<float>* component : { &m_semiMajorAxis, &m_eccentricity, &m_semiMinorAxis, &m_mass, &m_meanAnomaly0,
+                                           &m_periapsisX, &m_periapsisY, &m_periapsisZ, &m_normalX, &m_normalY, &m_normalZ,
+                                           &m_x, &m_y, &m_z })
+        component->reserve(count);
+    m_meanMotion.reserve(count);
+}
+
+
+
+size_t OrbitalSystem::add(const OrbitalElements& elements, float mass)
+{
+    float a = elements.semiMajorAxis;
+    float e = elements.eccentricity;
+    m_semiMajorAxis.push_back(a);
+    m_eccentricity.push_back(e);
+    m_semiMinorAxis.push_back(a * std::sqrt(1.0f - e * e));
+    m_mass.push_back(mass);
+    m_meanAnomaly0.push_back(elements.meanAnomaly);
+    m_meanMotion.push_back(std::sqrt(static_cast<double>(m_centralGM) / (static_cast<double>(a) * a * a)));
+
+    // Базис плоскости орбиты (P - на перицентр, Q - на 90 градусов по движению) в системе с опорной плоскостью XY,
+    // затем поворот в систему сцены с опорной плоскостью XZ: (x, y, z) -> (x, z, -y)
+    float cosNode = std::cos(elements.ascendingNode), sinNode = std::sin(elements.ascendingNode);
+    float cosPeri = std::cos(elements.argumentOfPeriapsis), sinPeri = std::sin(elements.argumentOfPeriapsis);
+    float cosInc = std::cos(elements.inclination), sinInc = std::sin(elements.inclination);
+    glm::vec3 p(cosNode * cosPeri - sinNode * sinPeri * cosInc,
+                sinNode * cosPeri + cosNode * sinPeri * cosInc,
+                sinPeri * sinInc);
+    glm::vec3 q(-cosNode * sinPeri - sinNode * cosPeri * cosInc,
+                -sinNode * sinPeri + cosNode * cosPeri * cosInc,
+                cosPeri * sinInc);
+    m_periapsisX.push_back(p.x);
+    m_periapsisY.push_back(p.z);
+    m_periapsisZ.push_back(-p.y);
+    m_normalX.push_back(q.x);
+    m_normalY.push_back(q.z);
+    m_normalZ.push_back(-q.y);
+
+    m_x.push_back(0.0f);
+    m_y.push_back(0.0f);
+    m_z.push_back(0.0f);
+    m_nbodySeeded = false;
+    return size() - 1;
+}
+
+
+
+void OrbitalSystem::setIntegrator(Integrator integrator)
+{
+    m_integrator = integrator;
+    m_nbodySeeded = false;
+}
+
+
+
+void OrbitalSystem::propagate(double time, ThreadPool* workers)
+{
+    PROFILE_ZONE("OrbitalSystem::propagate");
+
+    if (m_integrator == Integrator::Kepler)
+    {
+        if (workers == nullptr)
+            solveRange(0, size(), time);
+        else
+            workers->parallelFor(size(), PARALLEL_GRAIN, [this, time](size_t begin, size_t end) {
+                solveRange(begin, end, time);
+            });
+        return;
+    }
+
+    // Назад во времени (раньше предыдущего шага) или после долгой паузы не интегрируем, а начинаем с невозмущенных орбит
+    if (!m_nbodySeeded || time < m_nbodyTime - NBODY_STEP || time - m_nbodyTime > 1.0)
+        seedNBody(time);
+    // Допуск на накопленную ошибку суммы шагов: время, кратное шагу, не должно добавлять лишний шаг
+    while (m_nbodyTime < time - 1e-9)
+        stepNBody(workers);
+    blendNBody(time, workers);
+}
+
+
+
+void OrbitalSystem::writePositions(TransformSystem& transforms, TransformSystem::Handle first) const
+{
+    transforms.setPositions(first, size(), m_x.data(), m_y.data(), m_z.data());
+}
+
+
+
+float OrbitalSystem::meanAnomaly(size_t i, double time) const
+{
+    double revolutions = (static_cast<double>(m_meanAnomaly0[i]) + m_meanMotion[i] * time) / TWO_PI;
+    return static_cast<float>((revolutions - std::floor(revolutions)) * TWO_PI);
+}
+
+
+
+void OrbitalSystem::solveRange(size_t begin, size_t end, double time)
+{
+    size_t i = begin;
+
+#ifdef ONION_SIMD_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 pi = _mm_set1_ps(3.14159265f);
+    const __m128 danby = _mm_set1_ps(0.85f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (; i + 4 <= end; i += 4)
+    {
+        // Средняя аномалия приводится к [0, 2pi) в double, дальше достаточно float
+        __m128 meanAnomaly = _mm_set_ps(this->meanAnomaly(i + 3, time), this->meanAnomaly(i + 2, time),
+                                        this->meanAnomaly(i + 1, time), this->meanAnomaly(i, time));
+        __m128 e = _mm_loadu_ps(&m_eccentricity[i]);
+
+        // Начальное приближение Данби: знак поправки - знак sin M
+        __m128 guessSign = _mm_and_ps(_mm_cmpgt_ps(meanAnomaly, pi), signMask);
+        __m128 anomaly = _mm_add_ps(meanAnomaly, _mm_xor_ps(_mm_mul_ps(danby, e), guessSign));
+
+        __m128 sine, cosine;
+        for (int iteration = 0; iteration < NEWTON_ITERATIONS; iteration++)
+        {
+            sinCos(anomaly, sine, cosine);
+            __m128 f = _mm_sub_ps(_mm_sub_ps(anomaly, _mm_mul_ps(e, sine)), meanAnomaly);
+            __m128 derivative = _mm_sub_ps(one, _mm_mul_ps(e, cosine));
+            anomaly = _mm_sub_ps(anomaly, _mm_div_ps(f, derivative));
+        }
+        sinCos(anomaly, sine, cosine);
+
+        // Положение в плоскости орбиты и перевод в систему сцены через P и Q
+        __m128 u = _mm_mul_ps(_mm_loadu_ps(&m_semiMajorAxis[i]), _mm_sub_ps(cosine, e));
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(&m_semiMinorAxis[i]), sine);
+        _mm_storeu_ps(&m_x[i], _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(&m_periapsisX[i])), _mm_mul_ps(v, _mm_loadu_ps(&m_normalX[i]))));
+        _mm_storeu_ps(&m_y[i], _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(&m_periapsisY[i])), _mm_mul_ps(v, _mm_loadu_ps(&m_normalY[i]))));
+        _mm_storeu_ps(&m_z[i], _mm_add_ps(_mm_mul_ps(u, _mm_loadu_ps(&m_periapsisZ[i])), _mm_mul_ps(v, _mm_loadu_ps(&m_normalZ[i]))));
+    }
+#endif
+
+    for (; i < end; i++)
+        solveOne(i, time);
+}
+
+
+
+float OrbitalSystem::eccentricAnomaly(size_t i, double time) const
+{
+    float meanAnomaly = this->meanAnomaly(i, time);
+    float e = m_eccentricity[i];
+    float anomaly = keplerInitialGuess(meanAnomaly, e);
+    for (int iteration = 0; iteration < NEWTON_ITERATIONS; iteration++)
+        anomaly -= (anomaly - e * std::sin(anomaly) - meanAnomaly) / (1.0f - e * std::cos(anomaly));
+    return anomaly;
+}
+
+
+
+void OrbitalSystem::solveOne(size_t i, double time)
+{
+    float anomaly = eccentricAnomaly(i, time);
+    float e = m_eccentricity[i];
+    float u = m_semiMajorAxis[i] * (std::cos(anomaly) - e);
+    float v = m_semiMinorAxis[i] * std::sin(anomaly);
+    m_x[i] = u * m_periapsisX[i] + v * m_normalX[i];
+    m_y[i] = u * m_periapsisY[i] + v * m_normalY[i];
+    m_z[i] = u * m_periapsisZ[i] + v * m_normalZ[i];
+}
+
+
+
+void OrbitalSystem::seedNBody(double time)
+{
+    PROFILE_ZONE("OrbitalSystem::seedNBody");
+
+    size_t count = size();
+    m_vx.resize(count);
+    m_vy.resize(count);
+    m_vz.resize(count);
+    m_ax.assign(count, 0.0f);
+    m_ay.assign(count, 0.0f);
+    m_az.assign(count, 0.0f);
+
+    // Положения и скорости невозмущенных орбит: dE/dt = n / (1 - e cos E)
+    for (size_t i = 0; i < count; i++)
+    {
+        solveOne(i, time);
+        float e = m_eccentricity[i];
+        float anomaly = eccentricAnomaly(i, time);
+        float rate = static_cast<float>(m_meanMotion[i]) / (1.0f - e * std::cos(anomaly));
+        float du = -m_semiMajorAxis[i] * std::sin(anomaly) * rate;
+        float dv = m_semiMinorAxis[i] * std::cos(anomaly) * rate;
+        m_vx[i] = du * m_periapsisX[i] + dv * m_normalX[i];
+        m_vy[i] = du * m_periapsisY[i] + dv * m_normalY[i];
+        m_vz[i] = du * m_periapsisZ[i] + dv * m_normalZ[i];
+    }
+    m_bodyX = m_previousX = m_x;
+    m_bodyY = m_previousY = m_y;
+    m_bodyZ = m_previousZ = m_z;
+
+    if (!m_tree)
+        m_tree.reset(new BarnesHut());
+    m_tree->build(m_bodyX.data(), m_bodyY.data(), m_bodyZ.data(), m_mass.data(), count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 a = nbodyAcceleration(i);
+        m_ax[i] = a.x;
+        m_ay[i] = a.y;
+        m_az[i] = a.z;
+    }
+
+    m_nbodyTime = time;
+    m_nbodySeeded = true;
+}
+
+
+
+glm::vec3 OrbitalSystem::nbodyAcceleration(size_t i) const
+{
+    // Притяжение центрального тела плюс приближенное притяжение остальных тел
+    glm::vec3 p(m_bodyX[i], m_bodyY[i], m_bodyZ[i]);
+    float r2 = glm::dot(p, p) + NBODY_SOFTENING2;
+    return m_tree->acceleration(p, m_mass[i], NBODY_THETA, NBODY_SOFTENING2) - p * (m_centralGM / (r2 * std::sqrt(r2)));
+}
+
+
+
+void OrbitalSystem::stepNBody(ThreadPool* workers)
+{
+    PROFILE_ZONE("OrbitalSystem::stepNBody");
+
+    // Leapfrog kick-drift-kick: ускорения начала шага остались от конца предыдущего
+    const float dt = static_cast<float>(NBODY_STEP);
+    auto kickDrift = [this, dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            m_vx[i] += m_ax[i] * dt * 0.5f;
+            m_vy[i] += m_ay[i] * dt * 0.5f;
+            m_vz[i] += m_az[i] * dt * 0.5f;
+            m_previousX[i] = m_bodyX[i];
+            m_previousY[i] = m_bodyY[i];
+            m_previousZ[i] = m_bodyZ[i];
+            m_bodyX[i] += m_vx[i] * dt;
+            m_bodyY[i] += m_vy[i] * dt;
+            m_bodyZ[i] += m_vz[i] * dt;
+        }
+    };
+    auto accelerateKick = [this, dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 a = nbodyAcceleration(i);
+            m_ax[i] = a.x;
+            m_ay[i] = a.y;
+            m_az[i] = a.z;
+            m_vx[i] += a.x * dt * 0.5f;
+            m_vy[i] += a.y * dt * 0.5f;
+            m_vz[i] += a.z * dt * 0.5f;
+        }
+    };
+
+    // Обход дерева дороже интегрирования: силы раздаем порциями меньше PARALLEL_GRAIN
+    const size_t forceGrain = 256;
+    if (workers == nullptr)
+        kickDrift(0, size());
+    else
+        workers->parallelFor(size(), PARALLEL_GRAIN, kickDrift);
+
+    m_tree->build(m_bodyX.data(), m_bodyY.data(), m_bodyZ.data(), m_mass.data(), size());
+
+    if (workers == nullptr)
+        accelerateKick(0, size());
+    else
+        workers->parallelFor(size(), forceGrain, accelerateKick);
+
+    m_nbodyTime += NBODY_STEP;
+}
+
+
+
+void OrbitalSystem::blendNBody(double time, ThreadPool* workers)
+{
+    // Доля пути от предыдущего шага к текущему; сразу после seedNBody оба шага совпадают
+    const float alpha = static_cast<float>(std::min(std::max(1.0 - (m_nbodyTime - time) / NBODY_STEP, 0.0), 1.0));
+    auto blend = [this, alpha](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            m_x[i] = m_previousX[i] + (m_bodyX[i] - m_previousX[i]) * alpha;
+            m_y[i] = m_previousY[i] + (m_bodyY[i] - m_previousY[i]) * alpha;
+            m_z[i] = m_previousZ[i] + (m_bodyZ[i] - m_previousZ[i]) * alpha;
+        }
+    };
+    if (workers == nullptr)
+        blend(0, size());
+    else
+        workers->parallelFor(size(), PARALLEL_GRAIN, blend);
+}
@@ -0,0 +1,114 @@
+#ifndef ORBITAL_SYSTEM_H
+#define ORBITAL_SYSTEM_H
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "threadpool.h"
+#include "transformsystem.h"
+
+class BarnesHut;
+
+// Кеплеровы элементы эллиптической орбиты. Углы в радианах, опорная плоскость - XZ сцены
+struct OrbitalElements
+{
+    float semiMajorAxis = 1.0f;
+    float eccentricity = 0.0f;          // 0 <= e < 1
+    float inclination = 0.0f;
+    float ascendingNode = 0.0f;         // Долгота восходящего узла
+    float argumentOfPeriapsis = 0.0f;
+    float meanAnomaly = 0.0f;           // Средняя аномалия в момент времени 0
+};
+
+/**
+ * @brief OrbitalSystem - Движение тел вокруг центрального тела с гравитационным параметром GM.
+ * Элементы хранятся структурой массивов. По умолчанию положения вычисляются аналитически: уравнение Кеплера
+ * решается методом Ньютона по четыре тела за раз (SSE, на остальных платформах - скалярно), работа делится
+ * между потоками ThreadPool. Интегратор BarnesHut вместо этого интегрирует взаимное притяжение тел
+ * (leapfrog с фиксированным шагом, силы через октодерево Барнса-Хата) от состояния, заданного элементами.
+ */
+class OrbitalSystem
+{
+public:
+    enum class Integrator
+    {
+        Kepler,     // Невозмущенные орбиты, положение - функция времени
+        BarnesHut   // Центральное тело плюс взаимное притяжение тел, шаг NBODY_STEP
+    };
+
+    static const size_t PARALLEL_GRAIN = 4096;   // Кратно четырем: порции проходят пакетами целиком
+    static const int NEWTON_ITERATIONS = 6;
+    static constexpr double NBODY_STEP = 1.0 / 60.0;
+
+    explicit OrbitalSystem(float centralGM);
+    ~OrbitalSystem();
+    OrbitalSystem(const OrbitalSystem&) = delete;
+    OrbitalSystem& operator=(const OrbitalSystem&) = delete;
+
+    void reserve(size_t count);
+
+    /**
+     * @brief add - Добавляем тело.
+     * @param mass - Гравитационный параметр тела (G * m), учитывается только интегратором BarnesHut.
+     * @return - Индекс тела.
+     */
+    size_t add(const OrbitalElements& elements, float mass = 0.0f);
+    size_t size() const { return m_semiMajorAxis.size(); }
+
+    void setIntegrator(Integrator integrator);
+    Integrator integrator() const { return m_integrator; }
+
+    /**
+     * @brief propagate - Вычисляем положения тел в момент time. Интегратор BarnesHut делает шаги до первой границы
+     * шага не раньше time и смешивает положения двух последних шагов по доле шага, как камера между шагами симуляции;
+     * при движении назад во времени он начинает заново с элементов.
+     * @param workers - Потоки для деления работы (nullptr - в вызывающем потоке).
+     */
+    void propagate(double time, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief writePositions - Переносим положения тел в трансформации first..first + size() - 1.
+     */
+    void writePositions(TransformSystem& transforms, TransformSystem::Handle first) const;
+
+    const float* positionsX() const { return m_x.data(); }
+    const float* positionsY() const { return m_y.data(); }
+    const float* positionsZ() const { return m_z.data(); }
+
+private:
+    void solveRange(size_t begin, size_t end, double time);
+    void solveOne(size_t i, double time);
+    float meanAnomaly(size_t i, double time) const;
+    float eccentricAnomaly(size_t i, double time) const;
+    void seedNBody(double time);
+    void stepNBody(ThreadPool* workers);
+    void blendNBody(double time, ThreadPool* workers);
+    glm::vec3 nbodyAcceleration(size_t i) const;
+
+private:
+    float                       m_centralGM;
+    Integrator                  m_integrator = Integrator::Kepler;
+
+    // Элементы и производные от них величины
+    std::vector<float>          m_semiMajorAxis, m_eccentricity, m_semiMinorAxis, m_mass;
+    std::vector<float>          m_meanAnomaly0;
+    std::vector<double>         m_meanMotion;           // Двойная точность: n * t за часы работы
+    std::vector<float>          m_periapsisX, m_periapsisY, m_periapsisZ;   // Единичный вектор на перицентр (P)
+    std::vector<float>          m_normalX, m_normalY, m_normalZ;            // Перпендикуляр к P в плоскости орбиты (Q)
+
+    // Текущие положения
+    std::vector<float>          m_x, m_y, m_z;
+
+    // Состояние интегратора BarnesHut: положения на шаге m_nbodyTime и на предыдущем шаге
+    std::vector<float>          m_bodyX, m_bodyY, m_bodyZ;
+    std::vector<float>          m_previousX, m_previousY, m_previousZ;
+    std::vector<float>          m_vx, m_vy, m_vz;
+    std::vector<float>          m_ax, m_ay, m_az;
+    std::unique_ptr<BarnesHut>  m_tree;
+    double                      m_nbodyTime = 0.0;
+    bool                        m_nbodySeeded = false;
+};
+
+#endif // ORBITAL_SYSTEM_H
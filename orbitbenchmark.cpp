@@ -0,0 +1,115 @@
+#include "orbitbenchmark.h"
+#include "benchmark.h"
+#include "orbitalsystem.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const int PASSES = 15;
+    const int NBODY_STEPS = 5;
+    const double TIME = 12345.678;  // Момент замера: далеко от нуля, чтобы проверить точность n * t
+    const double PI = 3.141592653589793;
+
+    // Эталон: уравнение Кеплера в double до сходимости, тот же перевод (x, y, z) -> (x, z, -y) в систему сцены
+    void referencePosition(const OrbitalElements& elements, double gm, double time, double* out)
+    {
+        double a = elements.semiMajorAxis;
+        double e = elements.eccentricity;
+        double n = std::sqrt(gm / (a * a * a));
+        double meanAnomaly = std::fmod(elements.meanAnomaly + n * time, 2.0 * PI);
+        double anomaly = e < 0.8 ? meanAnomaly : PI;
+        for (int iteration = 0; iteration < 50; iteration++)
+        {
+            double delta = (anomaly - e * std::sin(anomaly) - meanAnomaly) / (1.0 - e * std::cos(anomaly));
+            anomaly -= delta;
+            if (std::abs(delta) < 1e-14)
+                break;
+        }
+        double u = a * (std::cos(anomaly) - e);
+        double v = a * std::sqrt(1.0 - e * e) * std::sin(anomaly);
+
+        double cosNode = std::cos(elements.ascendingNode), sinNode = std::sin(elements.ascendingNode);
+        double cosPeri = std::cos(elements.argumentOfPeriapsis), sinPeri = std::sin(elements.argumentOfPeriapsis);
+        double cosInc = std::cos(elements.inclination), sinInc = std::sin(elements.inclination);
+        double p[3] = { cosNode * cosPeri - sinNode * sinPeri * cosInc, sinNode * cosPeri + cosNode * sinPeri * cosInc, sinPeri * sinInc };
+        double q[3] = { -cosNode * sinPeri - sinNode * cosPeri * cosInc, -sinNode * sinPeri + cosNode * cosPeri * cosInc, cosPeri * sinInc };
+        out[0] = u * p[0] + v * q[0];
+        out[1] = u * p[2] + v * q[2];
+        out[2] = -(u * p[1] + v * q[1]);
+    }
+}
+
+
+
+int runOrbitBenchmark(size_t count)
+{
+    // Повторяемый набор: полуоси 1..10, эксцентриситеты до 0.9, произвольные ориентации
+    const float gm = 1.0f;
+    std::mt19937 random(54321);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float twoPi = 6.28318531f;
+
+    std::vector<OrbitalElements> elements(count);
+    OrbitalSystem orbits(gm);
+    orbits.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        OrbitalElements& body = elements[i];
+        body.semiMajorAxis = 1.0f + 9.0f * unit(random);
+        body.eccentricity = 0.9f * unit(random) * unit(random);
+        body.inclination = 3.14159265f * unit(random);
+        body.ascendingNode = twoPi * unit(random);
+        body.argumentOfPeriapsis = twoPi * unit(random);
+        body.meanAnomaly = twoPi * unit(random);
+        orbits.add(body, gm * 1e-6f);
+    }
+
+    ThreadPool workers;
+
+    std::cout << "Orbit benchmark: " << count << " bodies, median of " << PASSES << " passes, "
+              << workers.concurrency() << " threads"
+#ifdef ONION_SIMD_SSE
+              << ", SSE"
+#endif
+              << std::endl;
+
+    std::vector<double> reference(count * 3);
+    double scalarMs = Benchmark::measure([&]() {
+        for (size_t i = 0; i < count; i++)
+            referencePosition(elements[i], gm, TIME, &reference[i * 3]);
+    }, PASSES);
+    double singleMs = Benchmark::measure([&]() { orbits.propagate(TIME); }, PASSES);
+    double poolMs = Benchmark::measure([&]() { orbits.propagate(TIME, &workers); }, PASSES);
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "kepler scalar double " << std::setw(10) << scalarMs << " ms" << std::endl
+              << "kepler soa 1 thread  " << std::setw(10) << singleMs << " ms" << std::endl
+              << "kepler soa pool      " << std::setw(10) << poolMs << " ms" << std::endl;
+
+    // Погрешность относительно размера орбиты
+    double maxError = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        double dx = orbits.positionsX()[i] - reference[i * 3];
+        double dy = orbits.positionsY()[i] - reference[i * 3 + 1];
+        double dz = orbits.positionsZ()[i] - reference[i * 3 + 2];
+        maxError = std::max(maxError, std::sqrt(dx * dx + dy * dy + dz * dz) / elements[i].semiMajorAxis);
+    }
+    std::cout << std::scientific << std::setprecision(2) << "max error vs double / semi-major axis: " << maxError << std::endl;
+
+    // Шаг Барнса-Хата: посев состояния не замеряется, дальше каждый вызов делает ровно один шаг
+    orbits.setIntegrator(OrbitalSystem::Integrator::BarnesHut);
+    orbits.propagate(0.0, &workers);
+    int step = 0;
+    double nbodyMs = Benchmark::measure([&]() { orbits.propagate(++step * OrbitalSystem::NBODY_STEP, &workers); }, NBODY_STEPS);
+    std::cout << std::fixed << std::setprecision(3) << "barnes-hut step pool " << std::setw(10) << nbodyMs << " ms" << std::endl;
+    return 0;
+}
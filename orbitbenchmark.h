@@ -0,0 +1,14 @@
+#ifndef ORBIT_BENCHMARK_H
+#define ORBIT_BENCHMARK_H
+
+#include <cstddef>
+
+/**
+ * @brief runOrbitBenchmark - Микробенчмарк движения тел: для count случайных орбит сравниваем скалярное решение
+ * уравнения Кеплера в double (оно же эталон точности) с OrbitalSystem в одном потоке и на ThreadPool,
+ * затем замеряем шаг интегратора BarnesHut. GL-контекст не нужен.
+ * @return - Код возврата процесса (0 при успехе).
+ */
+int runOrbitBenchmark(size_t count);
+
+#endif // ORBIT_BENCHMARK_H
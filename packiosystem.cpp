@@ -0,0 +1,110 @@
+#include "packiosystem.h"
+
+#include <algorithm>
+#include <cstring>
+
+PackIOStream::PackIOStream(AssetPack::Data data) : m_data(std::move(data))
+{
+    // Перемещение вектора не меняет адрес его данных, поэтому указатель на распакованную копию остается верным
+}
+
+
+
+size_t PackIOStream::Read(void* buffer, size_t size, size_t count)
+{
+    if (size == 0 || count == 0)
+        return 0;
+    // Как fread: читаются только целые элементы
+    size_t elements = std::min(count, (m_data.size - m_position) / size);
+    std::memcpy(buffer, m_data.data + m_position, elements * size);
+    m_position += elements * size;
+    return elements;
+}
+
+
+
+size_t PackIOStream::Write(const void* buffer, size_t size, size_t count)
+{
+    static_cast<void>(buffer);
+    static_cast<void>(size);
+    static_cast<void>(count);
+    return 0;
+}
+
+
+
+aiReturn PackIOStream::Seek(size_t offset, aiOrigin origin)
+{
+    size_t base = 0;
+    if (origin == aiOrigin_CUR)
+        base = m_position;
+    else if (origin == aiOrigin_END)
+        base = m_data.size;
+    // Позиция за концом файла недопустима
+    if (offset > m_data.size || base > m_data.size - offset)
+        return aiReturn_FAILURE;
+    m_position = base + offset;
+    return aiReturn_SUCCESS;
+}
+
+
+
+size_t PackIOStream::Tell() const
+{
+    return m_position;
+}
+
+
+
+size_t PackIOStream::FileSize() const
+{
+    return m_data.size;
+}
+
+
+
+void PackIOStream::Flush()
+{
+}
+
+
+
+PackIOSystem::PackIOSystem(const AssetPack& pack) : m_pack(pack)
+{
+}
+
+
+
+bool PackIOSystem::Exists(const char* file) const
+{
+    return m_pack.contains(file) || m_files.Exists(file);
+}
+
+
+
+char PackIOSystem::getOsSeparator() const
+{
+    // Пути пакета всегда через '/', и Windows тоже принимает этот разделитель
+    return '/';
+}
+
+
+
+Assimp::IOStream* PackIOSystem::Open(const char* file, const char* mode)
+{
+    // Записывать в пакет нельзя: запись идет в обычный файл
+    if (std::strchr(mode, 'w') == nullptr)
+    {
+        AssetPack::Data data;
+        if (m_pack.read(file, data))
+            return new PackIOStream(std::move(data));
+    }
+    return m_files.Open(file, mode);
+}
+
+
+
+void PackIOSystem::Close(Assimp::IOStream* file)
+{
+    delete file;
+}
@@ -0,0 +1,49 @@
+#ifndef PACK_IO_SYSTEM_H
+#define PACK_IO_SYSTEM_H
+
+#include <Assimp/DefaultIOSystem.h>
+#include <Assimp/IOStream.hpp>
+#include <Assimp/IOSystem.hpp>
+
+#include "assetpack.h"
+
+/**
+ * @brief PackIOStream - Файл из AssetPack для Assimp: чтение идет из отображения пакета (или из распакованной копии).
+ */
+class PackIOStream : public Assimp::IOStream
+{
+public:
+    explicit PackIOStream(AssetPack::Data data);
+
+    size_t Read(void* buffer, size_t size, size_t count) override;
+    size_t Write(const void* buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t Tell() const override;
+    size_t FileSize() const override;
+    void Flush() override;
+
+private:
+    AssetPack::Data m_data;
+    size_t          m_position = 0;
+};
+
+/**
+ * @brief PackIOSystem - Файловая система Assimp поверх AssetPack: модель и ее .mtl открываются из пакета,
+ * файлы, которых в пакете нет, - с диска. Передается Importer::SetIOHandler, который становится ее владельцем.
+ */
+class PackIOSystem : public Assimp::IOSystem
+{
+public:
+    explicit PackIOSystem(const AssetPack& pack);
+
+    bool Exists(const char* file) const override;
+    char getOsSeparator() const override;
+    Assimp::IOStream* Open(const char* file, const char* mode = "rb") override;
+    void Close(Assimp::IOStream* file) override;
+
+private:
+    const AssetPack&        m_pack;
+    Assimp::DefaultIOSystem m_files;
+};
+
+#endif // PACK_IO_SYSTEM_H
@@ -0,0 +1,265 @@
+#include "renderer.h"
+#include "cpuprofiler.h"
+#include "sceneloader.h"
+
+namespace
+{
+    // Модели сцены
+    const char* const MARS_PATH = "../onion/models/mars.obj";
+    const char* const STAR_PATH = "../onion/models/sun.obj";
+    const char* const MILKY_WAY_PATH = "../onion/models/milkyWay.obj";
+
+    // Под бюджетом видеопамяти меши хранят копию геометрии, чтобы GpuMemory мог вытеснять их буферы
+    ImportProfile withEvictableGeometry(ImportProfile profile)
+    {
+        profile.keepGeometry = profile.keepGeometry || GpuMemory::budget() != 0;
+        return profile;
+    }
+}
+
+void Renderer::prefetchModels(ThreadPool& workers)
+{
+    SceneLoader::prefetch({ MARS_PATH, STAR_PATH, MILKY_WAY_PATH }, &workers);
+}
+
+
+
+Renderer::Renderer(ThreadPool& workers)
+    // Основные варианты шейдера отправляются драйверу пакетом. Когда они соберутся, их активные атрибуты и сэмплеры
+    // зададут профиль импорта: звезда и небо (UNLIT) не получают нормалей, касательных и лишних текстур
+    : m_workers(workers),
+      m_modelShaders("../onion/shaders/1.model_loading.vs", "../onion/shaders/1.model_loading.fs",
+                     {CLUSTERED, CLUSTERED | HAS_NORMAL_MAP, UNLIT}),
+      m_deferredLighting("../onion/shaders/deferred_lighting.vs", "../onion/shaders/deferred_lighting.fs", "", Shader::Build::Deferred),
+      // Модели импортируются в фоне (файлы начинают читаться еще в prefetchModels) и ждут профиль только перед
+      // постобработкой; пока они загружаются, вместо них рисуются заглушки
+      m_mars(SceneLoader::take(MARS_PATH, &workers), m_marsProfile.get_future().share(), &workers),
+      m_star(SceneLoader::take(STAR_PATH, &workers), m_starProfile.get_future().share(), &workers),
+      m_milkyWay(SceneLoader::take(MILKY_WAY_PATH, &workers), m_milkyWayProfile.get_future().share(), &workers)
+{
+    // Варианты заглушек; варианты материалов самих моделей готовятся, когда модели загрузятся
+    prepareModelVariants();
+
+    m_fullscreenVAO = VertexArrayHandle::create();
+    m_asteroidInstances = BufferHandle::create();
+    m_asteroidInstancesResource = GpuMemory::trackBuffer(m_asteroidInstances, GPU_MEMORY_INSTANCES, 0);
+}
+
+
+
+Renderer::~Renderer()
+{
+    // Фоновый импорт моделей ждет профиль, а деструкторы моделей ждут фоновый импорт
+    resolveImportProfiles(true);
+    GpuMemory::release(m_asteroidInstancesResource);
+}
+
+
+
+void Renderer::waitForModels()
+{
+    PROFILE_ZONE("Renderer::waitForModels");
+
+    resolveImportProfiles(true);
+    bool loaded = false;
+    for (Model* model : { &m_mars, &m_star, &m_milkyWay })
+        loaded |= model->finishLoading();
+    if (loaded)
+        prepareModelVariants();
+}
+
+
+
+void Renderer::Draw(const FrameState& state)
+{
+    PROFILE_ZONE("Renderer::Draw");
+
+    // Окно просмотра меняем только из потока рендеринга, т.к. только здесь текущим является GL-контекст
+    if (state.framebufferWidth != m_viewportWidth || state.framebufferHeight != m_viewportHeight)
+    {
+        m_viewportWidth = state.framebufferWidth;
+        m_viewportHeight = state.framebufferHeight;
+        glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+    }
+
+    m_gpuProfiler.beginFrame();
+
+    // Асинхронная загрузка моделей продвигается порцией за кадр
+    {
+        PROFILE_ZONE("Renderer::updateModels");
+        resolveImportProfiles(false);
+        bool loaded = false;
+        for (Model* model : { &m_mars, &m_star, &m_milkyWay })
+            loaded |= model->update();
+        if (loaded)
+            prepareModelVariants();
+    }
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Uniform-переменные камеры устанавливаются каждой программе, которую выбрал вариант меша
+    auto bindCamera = [&state](const Shader& shader) {
+        shader.setMat4("projection", state.projection);
+        shader.setMat4("view", state.view);
+    };
+
+    // Звезда
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "sun");
+        m_star.Draw(m_modelShaders, UNLIT, [&](const Shader& shader) {
+            bindCamera(shader);
+            shader.setMat4("model", state.starModel);
+        });
+    }
+
+    // Точечные источники распределяются по кластерам до отрисовки освещенных объектов
+    m_clusteredLighting.update(state, m_workers);
+    uploadAsteroids(state);
+    const GLsizei asteroidCount = static_cast<GLsizei>(state.asteroidModels.size());
+
+    // Планета и пояс астероидов
+    if (state.renderPath == RenderPath::Deferred)
+    {
+        drawDeferred(state, bindCamera);
+    }
+    else
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "mars");
+        m_mars.Draw(m_modelShaders, CLUSTERED, [&](const Shader& shader) {
+            bindCamera(shader);
+            m_clusteredLighting.apply(shader);
+            shader.setVec3("sourceLightPos", state.lightPosition);
+            shader.setMat4("model", state.planetModel);
+        });
+    }
+    if (state.renderPath == RenderPath::Forward && asteroidCount > 0)
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "asteroids");
+        m_mars.DrawInstanced(m_modelShaders, CLUSTERED, [&](const Shader& shader) {
+            bindCamera(shader);
+            m_clusteredLighting.apply(shader);
+            shader.setVec3("sourceLightPos", state.lightPosition);
+        }, m_asteroidInstances, asteroidCount);
+    }
+
+    // Небесная сфера
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "sky");
+        m_milkyWay.Draw(m_modelShaders, UNLIT, [&](const Shader& shader) {
+            bindCamera(shader);
+            shader.setMat4("model", state.skyModel);
+        });
+    }
+
+    if (state.showGpuOverlay)
+        m_gpuProfiler.drawOverlay(m_viewportWidth, m_viewportHeight);
+
+    m_gpuProfiler.endFrame();
+
+    // Ресурсы, которые не понадобились в этом кадре, - первые кандидаты на вытеснение при нехватке бюджета
+    GpuMemory::endFrame();
+
+    // Объекты, освобожденные за кадр, удаляются, когда GPU закончит кадр, в котором их еще могли читать
+    GLDeletionQueue::endFrame();
+}
+
+
+
+void Renderer::resolveImportProfiles(bool wait)
+{
+    if (m_profilesResolved)
+        return;
+    // Без GL_KHR_parallel_shader_compile готовность не узнать без ожидания, и профили задаются в первом же кадре
+    if (!wait && !(m_modelShaders.importProfileReady(CLUSTERED) && m_modelShaders.importProfileReady(UNLIT)))
+        return;
+
+    PROFILE_ZONE("Renderer::resolveImportProfiles");
+    m_marsProfile.set_value(withEvictableGeometry(m_modelShaders.importProfile(CLUSTERED)));
+    ImportProfile unlit = withEvictableGeometry(m_modelShaders.importProfile(UNLIT));
+    m_starProfile.set_value(unlit);
+    m_milkyWayProfile.set_value(unlit);
+    m_profilesResolved = true;
+}
+
+
+
+void Renderer::prepareModelVariants()
+{
+    // Варианты, которые нужны материалам моделей (например, с картой нормалей). Готовые варианты prepare пропускает
+    for (unsigned int key : m_mars.variantKeys(CLUSTERED))
+        m_modelShaders.prepare(key);
+    for (unsigned int key : m_star.variantKeys(UNLIT))
+        m_modelShaders.prepare(key);
+    for (unsigned int key : m_milkyWay.variantKeys(UNLIT))
+        m_modelShaders.prepare(key);
+    for (unsigned int key : m_mars.variantKeys(GBUFFER))
+        m_modelShaders.prepare(key);
+    // Астероиды - экземпляры меша планеты
+    for (unsigned int key : m_mars.variantKeys(CLUSTERED | INSTANCED))
+        m_modelShaders.prepare(key);
+    for (unsigned int key : m_mars.variantKeys(GBUFFER | INSTANCED))
+        m_modelShaders.prepare(key);
+}
+
+
+
+void Renderer::uploadAsteroids(const FrameState& state)
+{
+    if (state.asteroidModels.empty())
+        return;
+
+    PROFILE_ZONE("Renderer::uploadAsteroids");
+    // Буфер пересоздается каждый кадр: драйвер не ждет, пока GPU дочитает матрицы прошлого кадра
+    glBindBuffer(GL_ARRAY_BUFFER, m_asteroidInstances);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(state.asteroidModels.size() * sizeof(glm::mat4)),
+                 state.asteroidModels.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GpuMemory::resize(m_asteroidInstancesResource, state.asteroidModels.size() * sizeof(glm::mat4));
+}
+
+
+
+void Renderer::drawDeferred(const FrameState& state, const std::function<void(const Shader&)>& bindCamera)
+{
+    PROFILE_ZONE("Renderer::drawDeferred");
+
+    // Проход освещения пишет в тот кадровый буфер, который был текущим (окно или FBO безоконного режима)
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "gbuffer");
+        m_gbuffer.resize(m_viewportWidth, m_viewportHeight);
+        m_gbuffer.bindForWriting();
+        m_mars.Draw(m_modelShaders, GBUFFER, [&](const Shader& shader) {
+            bindCamera(shader);
+            shader.setMat4("model", state.planetModel);
+        });
+        if (!state.asteroidModels.empty())
+            m_mars.DrawInstanced(m_modelShaders, GBUFFER, bindCamera, m_asteroidInstances, static_cast<GLsizei>(state.asteroidModels.size()));
+        glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target));
+    }
+
+    {
+        GpuProfiler::Scope scope(m_gpuProfiler, "lighting");
+        m_gbuffer.bindTextures();
+        m_deferredLighting.use();
+        m_deferredLighting.setMat4("inverseViewProjection", glm::inverse(state.projection * state.view));
+        m_deferredLighting.setMat4("view", state.view);
+        // Нормали G-буфера мировые, поэтому освещает сама звезда, а не повернутая в систему планеты позиция прямого пути
+        m_deferredLighting.setVec3("sourceLightPos", glm::vec3(state.starModel[3]));
+        m_clusteredLighting.apply(m_deferredLighting);
+
+        glBindVertexArray(m_fullscreenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+    }
+}
+
+
+
+const GpuProfiler& Renderer::gpuProfiler() const
+{
+    return m_gpuProfiler;
+}
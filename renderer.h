@@ -0,0 +1,105 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "FrameState.hpp"
+#include "clusteredlighting.h"
+#include "gbuffer.h"
+#include "gpuprofiler.h"
+#include "model.h"
+#include "shadervariants.h"
+#include "threadpool.h"
+
+#include <future>
+
+/**
+ * @brief Renderer - Владеет всеми GL-ресурсами сцены (шейдеры, модели) и рисует снимки FrameState.
+ * Создается, используется и уничтожается только в потоке, в котором текущим является GL-контекст.
+ */
+class Renderer
+{
+public:
+    /**
+     * @brief Renderer - Компилирует шейдеры и начинает фоновую загрузку моделей сцены. Требует текущий GL-контекст.
+     * @param workers - Общий пул рабочих потоков: подготовка кадра и упаковка мешей моделей. Должен пережить Renderer.
+     */
+    explicit Renderer(ThreadPool& workers);
+    ~Renderer();
+
+    /**
+     * @brief prefetchModels - Начинаем читать файлы моделей сцены в фоновых потоках. Не требует GL-контекста,
+     * поэтому вызывается при запуске, чтобы чтение шло одновременно с созданием окна и контекста.
+     */
+    static void prefetchModels(ThreadPool& workers);
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    /**
+     * @brief Draw - Отрисовываем сцену по снимку состояния.
+     * @param state - Снимок, подготовленный потоком обновления.
+     */
+    void Draw(const FrameState& state);
+
+    /**
+     * @brief waitForModels - Дожидаемся загрузки всех моделей (например, перед замером кадров). Иначе модели
+     * догружаются порциями в Draw, а до тех пор рисуются заглушками.
+     */
+    void waitForModels();
+
+    /**
+     * @brief gpuProfiler - Профайлер GPU-проходов сцены (sun, mars, asteroids, sky).
+     */
+    const GpuProfiler& gpuProfiler() const;
+
+private:
+    /**
+     * @brief resolveImportProfiles - Задаем профили импорта моделей по собранным вариантам шейдера.
+     * @param wait - Дождаться компиляции. Иначе, пока варианты собираются, профили остаются незаданными.
+     */
+    void resolveImportProfiles(bool wait);
+
+    /**
+     * @brief prepareModelVariants - Готовим варианты шейдера, которые нужны текущим мешам моделей (или их заглушкам).
+     */
+    void prepareModelVariants();
+
+    /**
+     * @brief uploadAsteroids - Загружаем матрицы астероидов снимка в буфер экземпляров.
+     */
+    void uploadAsteroids(const FrameState& state);
+
+    /**
+     * @brief drawDeferred - Освещенные объекты через G-буфер: запись альбедо/нормалей/глубины
+     * и полноэкранный проход освещения в текущий кадровый буфер.
+     */
+    void drawDeferred(const FrameState& state, const std::function<void(const Shader&)>& bindCamera);
+
+private:
+    GpuProfiler         m_gpuProfiler;
+    ThreadPool&         m_workers;          // Рабочие потоки для CPU-подготовки кадра (общие с потоком обновления и загрузкой)
+
+    ShaderVariants      m_modelShaders;     // Варианты 1.model_loading: освещенный с кластерами (планеты) и UNLIT (звезда, небо)
+    ClusteredLighting   m_clusteredLighting;
+
+    // Отложенное освещение (RenderPath::Deferred)
+    GBuffer             m_gbuffer;
+    Shader              m_deferredLighting;
+    VertexArrayHandle   m_fullscreenVAO;      // Пустой VAO для полноэкранного треугольника (core profile требует VAO)
+
+    BufferHandle        m_asteroidInstances;      // Матрицы экземпляров пояса астероидов
+    GpuMemory::ResourceId m_asteroidInstancesResource = GpuMemory::NO_RESOURCE;
+
+    // Профили импорта моделей. Файлы читаются, пока собираются шейдеры, а профиль нужен только для постобработки
+    std::promise<ImportProfile> m_marsProfile;
+    std::promise<ImportProfile> m_starProfile;
+    std::promise<ImportProfile> m_milkyWayProfile;
+    bool                m_profilesResolved = false;
+
+    Model               m_mars;
+    Model               m_star;
+    Model               m_milkyWay;
+
+    int                 m_viewportWidth = 0;
+    int                 m_viewportHeight = 0;
+};
+
+#endif // RENDERER_H
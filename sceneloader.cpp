@@ -0,0 +1,55 @@
+#include "sceneloader.h"
+
+#include <map>
+#include <mutex>
+
+namespace
+{
+    std::mutex                                      s_mutex;
+    std::map<std::string, std::future<ModelSource>> s_pending;
+
+    std::future<ModelSource> startRead(const std::string& path, ThreadPool* workers)
+    {
+        // Путь копируется в лямбду: чтение переживает вызов prefetch
+        return std::async(std::launch::async, [path, workers]() { return ModelImport::read(path, aiProcess_Triangulate, workers); });
+    }
+}
+
+
+
+void SceneLoader::prefetch(const std::vector<std::string>& paths, ThreadPool* workers)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (const std::string& path : paths)
+    {
+        if (s_pending.find(path) == s_pending.end())
+            s_pending.emplace(path, startRead(path, workers));
+    }
+}
+
+
+
+std::future<ModelSource> SceneLoader::take(const std::string& path, ThreadPool* workers)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    auto found = s_pending.find(path);
+    if (found == s_pending.end())
+        return startRead(path, workers);
+    std::future<ModelSource> result = std::move(found->second);
+    s_pending.erase(found);
+    return result;
+}
+
+
+
+void SceneLoader::shutdown()
+{
+    std::map<std::string, std::future<ModelSource>> pending;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        pending.swap(s_pending);
+    }
+    // Ждем без блокировки: take из другого потока не должен стоять за чужим чтением
+    for (auto& read : pending)
+        read.second.wait();
+}
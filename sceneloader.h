@@ -0,0 +1,40 @@
+#ifndef SCENE_LOADER_H
+#define SCENE_LOADER_H
+
+#include "modelimport.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+/**
+ * @brief SceneLoader - Раннее чтение файлов моделей сцены. prefetch запускается при старте, до создания окна
+ * и GL-контекста: каждая модель читается в своем потоке своим Assimp::Importer (ModelImport::read), поэтому
+ * чтение всех файлов занимает примерно столько, сколько самый большой из них, и идет одновременно с созданием окна.
+ * Постобработку под профиль шейдера, декодирование текстур и загрузку в GPU доделывает Model (см. конструктор
+ * из std::future<ModelSource>); в GL-потоке остается только загрузка в GPU.
+ */
+namespace SceneLoader
+{
+    // Начинаем читать файлы paths (workers - потоки для разбора OBJ). Повторный prefetch уже читаемого файла ничего не делает
+    void prefetch(const std::vector<std::string>& paths, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief take - Забираем чтение файла path. Если prefetch его не запускал, чтение начинается сейчас.
+     */
+    std::future<ModelSource> take(const std::string& path, ThreadPool* workers = nullptr);
+
+    /**
+     * @brief shutdown - Дожидаемся чтений, которые никто не забрал (например, main вышел до создания Renderer).
+     * Чтения используют пул потоков main, поэтому должны закончиться до выхода из main.
+     */
+    void shutdown();
+
+    // Вызывает shutdown при выходе из области видимости: ни один ранний return из main его не пропустит
+    struct ShutdownGuard
+    {
+        ~ShutdownGuard() { shutdown(); }
+    };
+}
+
+#endif // SCENE_LOADER_H
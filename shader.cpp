@@ -1,17 +1,78 @@
 #include "shader.h"
+#include "assetpack.h"
+#include "cpuprofiler.h"
+#include "glextensions.h"
+#include "material.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // Заголовок файла кэша бинарной программы
+    struct ProgramBinaryHeader
+    {
+        char            magic[4];       // "OSPB"
+        std::uint32_t   version;
+        std::uint64_t   key;            // Повторяем ключ, чтобы отбросить чужой файл при коллизии имени
+        std::uint32_t   binaryFormat;
+        std::uint32_t   length;
+    };
+    const char PROGRAM_BINARY_MAGIC[4] = {'O', 'S', 'P', 'B'};
+    const std::uint32_t PROGRAM_BINARY_VERSION = 1;
+
+    // FNV-1a, 64 бита
+    void hashAppend(unsigned long long& hash, const std::string& text)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        // Разделитель, чтобы "ab"+"c" и "a"+"bc" давали разные ключи
+        hash ^= 0xFF;
+        hash *= 1099511628211ull;
+    }
+
+    // Исходник шейдера из подключенного AssetPack; false - в пакете его нет, читаем файл
+    bool readFromPack(const std::string& path, std::string& code)
+    {
+        const AssetPack* pack = AssetPack::mounted();
+        AssetPack::Data data;
+        if (pack == nullptr || !pack->read(path, data))
+            return false;
+        code.assign(reinterpret_cast<const char*>(data.data), data.size);
+        return true;
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+}
+
+std::string Shader::s_binaryCacheDirectory = "shader_cache";
 
 Shader::Shader(const std::string vertexPath,
                const std::string fragmentPath,
-               const std::string geometryPath)
+               const std::string geometryPath,
+               Build build,
+               const std::vector<std::string>& defines)
     : m_fileNameVertex(vertexPath),
       m_fileNameFragment(fragmentPath),
-      m_fileNameGeometry(geometryPath)
+      m_fileNameGeometry(geometryPath),
+      m_defines(defines)
 {
     try
     {
         readVertexShader();
         readFragmentShader();
-        if (m_codeGeometry.size() != 0)
+        if (m_fileNameGeometry.size() != 0)
         {
             readGeometryShader();
         }
@@ -20,104 +81,136 @@ Shader::Shader(const std::string vertexPath,
     {
         std::cout << "ERROR::SHADER::CAN'T READ FILE " << std::endl;
     }
-    m_idVertex = compileShader(VERTEX);
-    m_idFragment = compileShader(FRAGMENT);
-    if (m_fileNameGeometry.size())
+    injectDefines(m_codeVertex);
+    injectDefines(m_codeFragment);
+    injectDefines(m_codeGeometry);
+
+    // Если драйвер уже видел эти исходники, берем готовую программу из кэша и пропускаем компиляцию
+    m_cacheKey = computeCacheKey();
+    if (!submitProgramBinary())
     {
-        m_idGeometry = compileShader(GEOMETRY);
+        submitFromSource();
+    }
+
+    if (build == Build::Immediate)
+    {
+        finalize();
     }
-    compileShaderProgram();
 }
 
 
 
 void Shader::use() const
 {
+    ensureReady();
     glUseProgram(m_id);
 }
 
 
 
+bool Shader::isReady() const
+{
+    if (!m_pending || !GLExtensions::parallelShaderCompileSupported())
+        return true;
+    GLint completed = GL_FALSE;
+    glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+
+
+bool Shader::allReady(std::initializer_list<const Shader*> shaders)
+{
+    for (const Shader* shader : shaders)
+    {
+        if (!shader->isReady())
+            return false;
+    }
+    return true;
+}
+
+
+
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(m_id, name.c_str()), (int)value);
+    glUniform1i(uniformLocation(name), (int)value);
 }
 
 
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
+    glUniform1i(uniformLocation(name), value);
 }
 
 
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
+    glUniform1f(uniformLocation(name), value);
 }
 
 
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-    glUniform2fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    glUniform2fv(uniformLocation(name), 1, &value[0]);
 }
 
 
 
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-    glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+    glUniform2f(uniformLocation(name), x, y);
 }
 
 
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    glUniform3fv(uniformLocation(name), 1, &value[0]);
 }
 
 
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+    glUniform3f(uniformLocation(name), x, y, z);
 }
 
 
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-    glUniform4fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+    glUniform4fv(uniformLocation(name), 1, &value[0]);
 }
 
 
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
-    glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+    glUniform4f(uniformLocation(name), x, y, z, w);
 }
 
 
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 
@@ -157,6 +250,8 @@ void Shader::checkLinkingErrors(GLuint shader)
 
 void Shader::readVertexShader()
 {
+    if (readFromPack(m_fileNameVertex, m_codeVertex))
+        return;
     vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     vShaderFile.open(m_fileNameVertex);
     std::stringstream vShaderStream;
@@ -169,6 +264,8 @@ void Shader::readVertexShader()
 
 void Shader::readFragmentShader()
 {
+    if (readFromPack(m_fileNameFragment, m_codeFragment))
+        return;
     fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     fShaderFile.open(m_fileNameFragment);
     std::stringstream fShaderStream;
@@ -181,6 +278,8 @@ void Shader::readFragmentShader()
 
 void Shader::readGeometryShader()
 {
+    if (readFromPack(m_fileNameGeometry, m_codeGeometry))
+        return;
     gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     gShaderFile.open(m_fileNameGeometry);
     std::stringstream gShaderStream;
@@ -191,14 +290,45 @@ void Shader::readGeometryShader()
 
 
 
-unsigned int Shader::compileShader(Shader::ShaderType type)
+void Shader::injectDefines(std::string& code) const
 {
+    if (m_defines.empty() || code.empty())
+        return;
+
+    // #version обязан быть первой директивой, поэтому макросы вставляем сразу после него.
+    // #line возвращает исходную нумерацию строк, чтобы сообщения компилятора указывали на строки файла
+    size_t version = code.find("#version");
+    size_t insertAt = 0;
+    int nextLine = 1;
+    if (version != std::string::npos)
+    {
+        size_t lineEnd = code.find('\n', version);
+        insertAt = (lineEnd == std::string::npos) ? code.size() : lineEnd + 1;
+        for (size_t i = 0; i < insertAt; i++)
+        {
+            if (code[i] == '\n')
+                nextLine++;
+        }
+    }
+
+    std::string block = (insertAt == code.size() && insertAt > 0 && code.back() != '\n') ? "\n" : "";
+    for (const std::string& define : m_defines)
+        block += "#define " + define + "\n";
+    block += "#line " + std::to_string(nextLine) + "\n";
+    code.insert(insertAt, block);
+}
+
+
+
+ShaderHandle Shader::compileShader(Shader::ShaderType type)
+{
+    PROFILE_ZONE("Shader::compileShader");
+
     std::string codeCopy = getCode(type);
     const char* code = codeCopy.c_str();
-    unsigned int shader = glCreateShader(type);
+    ShaderHandle shader(glCreateShader(type));
     glShaderSource(shader, 1, &code, NULL);
     glCompileShader(shader);
-    checkCompileErrors(shader, type);
     return shader;
 }
 
@@ -206,18 +336,126 @@ unsigned int Shader::compileShader(Shader::ShaderType type)
 
 void Shader::compileShaderProgram()
 {
-    m_id = glCreateProgram();
+    PROFILE_ZONE("Shader::compileShaderProgram");
+
+    m_id = ProgramHandle::create();
     glAttachShader(m_id, m_idVertex);
     glAttachShader(m_id, m_idFragment);
     if (!m_codeGeometry.empty())
         glAttachShader(m_id, m_idGeometry);
+    if (GLExtensions::programBinarySupported())
+        GLExtensions::programParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(m_id);
+}
+
+
+
+void Shader::submitFromSource()
+{
+    // Отправляем все стадии и компоновку подряд, ни разу не запрашивая статус:
+    // любой glGet*iv по статусу заставил бы драйвер дождаться завершения компиляции
+    m_idVertex = compileShader(VERTEX);
+    m_idFragment = compileShader(FRAGMENT);
+    if (m_fileNameGeometry.size())
+    {
+        m_idGeometry = compileShader(GEOMETRY);
+    }
+    compileShaderProgram();
+    m_fromBinary = false;
+    m_pending = true;
+}
+
+
+
+void Shader::finalize()
+{
+    if (!m_pending)
+        return;
+    m_pending = false;
+
+    if (m_fromBinary)
+    {
+        GLint success = 0;
+        glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+        if (success)
+        {
+            bindTextureUnits();
+            return;
+        }
+
+        // Драйвер отверг бинарник (обновление драйвера, другой GPU, поврежденный файл): компилируем из исходников
+        discardProgramBinary();
+        submitFromSource();
+        m_pending = false;
+    }
+
+    checkCompileErrors(m_idVertex, VERTEX);
+    checkCompileErrors(m_idFragment, FRAGMENT);
+    if (!m_codeGeometry.empty())
+        checkCompileErrors(m_idGeometry, GEOMETRY);
     checkLinkingErrors(m_id);
+
     // После того, как мы связали шейдеры с нашей программой, удаляем их, т.к. они нам больше не нужны
-    glDeleteShader(m_idVertex);
-    glDeleteShader(m_idFragment);
-    if (!m_codeGeometry.empty())
-        glDeleteShader(m_idGeometry);
+    m_idVertex.reset();
+    m_idFragment.reset();
+    m_idGeometry.reset();
+
+    bindTextureUnits();
+    saveProgramBinary();
+}
+
+
+
+void Shader::bindTextureUnits()
+{
+    // Значения uniform-переменных задаются только текущей программе, поэтому временно переключаемся на нее
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    glUseProgram(m_id);
+
+    GLchar name[256];
+    GLint uniformCount = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(m_id, static_cast<GLuint>(i), sizeof(name), nullptr, &size, &type, name);
+
+        TextureSlot slot;
+        unsigned int index = 0;
+        if (type == GL_SAMPLER_2D && Material::parseSampler(name, slot, index))
+        {
+            glUniform1i(glGetUniformLocation(m_id, name), static_cast<GLint>(textureUnit(slot, index)));
+            continue;
+        }
+
+        for (unsigned int unit = TEXTURE_UNIT_CLUSTER_GRID; unit < TEXTURE_UNIT_RESERVED_END; unit++)
+        {
+            if (std::strcmp(name, reservedSamplerName(static_cast<ReservedTextureUnit>(unit))) == 0)
+                glUniform1i(glGetUniformLocation(m_id, name), static_cast<GLint>(unit));
+        }
+    }
+
+    glUseProgram(static_cast<GLuint>(previous));
+}
+
+
+
+void Shader::ensureReady() const
+{
+    // Отложенная проверка статуса меняет только внутреннее состояние сборки, поэтому допустима из const-методов.
+    // Объекты Shader всегда создаются неконстантными, так что const_cast здесь корректен
+    if (m_pending)
+        const_cast<Shader*>(this)->finalize();
+}
+
+
+
+GLint Shader::uniformLocation(const std::string& name) const
+{
+    ensureReady();
+    return glGetUniformLocation(m_id, name.c_str());
 }
 
 
@@ -272,5 +510,140 @@ unsigned int Shader::getShaderId(Shader::ShaderType type)
 
 unsigned int Shader::ID() const
 {
+    ensureReady();
     return m_id;
 }
+
+
+
+void Shader::setBinaryCacheDirectory(const std::string& directory)
+{
+    s_binaryCacheDirectory = directory;
+}
+
+
+
+unsigned long long Shader::computeCacheKey() const
+{
+    // Бинарная программа годится только для тех же исходников и того же драйвера.
+    // Макросы варианта к этому моменту уже вставлены в код, поэтому разные варианты получают разные ключи
+    unsigned long long hash = 14695981039346656037ull;
+    hashAppend(hash, m_codeVertex);
+    hashAppend(hash, m_codeFragment);
+    hashAppend(hash, m_codeGeometry);
+    hashAppend(hash, glString(GL_VENDOR));
+    hashAppend(hash, glString(GL_RENDERER));
+    hashAppend(hash, glString(GL_VERSION));
+    hashAppend(hash, glString(GL_SHADING_LANGUAGE_VERSION));
+    return hash;
+}
+
+
+
+std::string Shader::binaryCachePath() const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", m_cacheKey);
+    return s_binaryCacheDirectory + "/" + name;
+}
+
+
+
+bool Shader::submitProgramBinary()
+{
+    if (s_binaryCacheDirectory.empty() || !GLExtensions::programBinarySupported())
+        return false;
+
+    std::ifstream file(binaryCachePath(), std::ios::binary);
+    if (!file)
+        return false;
+
+    ProgramBinaryHeader header;
+    std::vector<char> binary;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        std::memcmp(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC)) == 0 &&
+        header.version == PROGRAM_BINARY_VERSION && header.key == m_cacheKey && header.length > 0)
+    {
+        binary.resize(header.length);
+        if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+            binary.clear();
+    }
+    file.close();
+
+    if (binary.empty())
+    {
+        discardProgramBinary();
+        return false;
+    }
+
+    // Результат загрузки (LINK_STATUS) проверяет finalize(), чтобы не ждать драйвер прямо здесь
+    m_id = ProgramHandle::create();
+    GLExtensions::programBinary(m_id, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+    m_fromBinary = true;
+    m_pending = true;
+    return true;
+}
+
+
+
+void Shader::discardProgramBinary()
+{
+    m_id.reset();
+    std::error_code error;
+    std::filesystem::remove(binaryCachePath(), error);
+}
+
+
+
+void Shader::saveProgramBinary() const
+{
+    if (s_binaryCacheDirectory.empty() || !GLExtensions::programBinarySupported() || m_id == 0)
+        return;
+
+    GLint linked = 0;
+    GLint length = 0;
+    glGetProgramiv(m_id, GL_LINK_STATUS, &linked);
+    glGetProgramiv(m_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!linked || length <= 0)
+        return;
+
+    std::vector<char> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    GLExtensions::getProgramBinary(m_id, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    ProgramBinaryHeader header;
+    std::memcpy(header.magic, PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+    header.version = PROGRAM_BINARY_VERSION;
+    header.key = m_cacheKey;
+    header.binaryFormat = format;
+    header.length = static_cast<std::uint32_t>(written);
+
+    // Пишем во временный файл и переименовываем, чтобы параллельный запуск не прочитал файл наполовину.
+    // Случайный суффикс не дает двум процессам писать в один временный файл
+    std::error_code error;
+    std::filesystem::create_directories(s_binaryCacheDirectory, error);
+    std::string path = binaryCachePath();
+    std::random_device random;
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", random(), random());
+    std::string tempPath = path + suffix;
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+        std::filesystem::remove(tempPath, error);
+}
@@ -4,7 +4,11 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "glresource.h"
+
+#include <initializer_list>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -28,19 +32,54 @@ private:
     void readVertexShader();
     void readFragmentShader();
     void readGeometryShader();
-    // Функции компиляции
+    // Вставляем #define из m_defines сразу после строки #version
+    void injectDefines(std::string& code) const;
+    // Функции компиляции. Только отправляют работу драйверу, статус проверяет finalize()
     void compileShaderProgram();
-    unsigned int compileShader(ShaderType type);
+    ShaderHandle compileShader(ShaderType type);
+    void submitFromSource();
+    // Проверка ошибок, удаление шейдерных объектов и сохранение в кэш. Вызывается один раз, перед первым использованием
+    void finalize();
+    void ensureReady() const;
+    // Расположение uniform-переменной; сначала дожидаемся сборки, иначе glUniform* уйдет в еще не слинкованную программу
+    GLint uniformLocation(const std::string& name) const;
+    // Сэмплерам по соглашению texture_<слот>N и служебным сэмплерам назначаем постоянные текстурные юниты (см. Texture.hpp)
+    void bindTextureUnits();
     // Внутренняя конвертация по enum'у
     std::string getFilePath(ShaderType type) const;
     std::string getCode(ShaderType type)const;
     unsigned int getShaderId(ShaderType type);
+    // Кэш бинарных программ (glGetProgramBinary/glProgramBinary)
+    unsigned long long computeCacheKey() const;
+    std::string binaryCachePath() const;
+    bool submitProgramBinary();
+    void discardProgramBinary();
+    void saveProgramBinary() const;
 
 
 public:
-	
-    // Конструктор генерирует шейдер "на лету"
-    Shader(const std::string vertexPath, const std::string fragmentPath, const std::string geometryPath = "");
+    // Режим сборки программы
+    enum class Build
+    {
+        Immediate,  // компиляция и проверка ошибок прямо в конструкторе
+        Deferred    // конструктор только отправляет работу драйверу, статус проверяется при первом использовании
+    };
+
+    // Конструктор генерирует шейдер "на лету".
+    // Для пакетной сборки создайте все программы в режиме Deferred подряд: драйвер с многопоточным компилятором
+    // (GL_KHR_parallel_shader_compile) соберет их параллельно, пока приложение занято другой работой.
+    // defines - имена макросов, которые добавляются во все стадии сразу после #version (варианты шейдера)
+    Shader(const std::string vertexPath, const std::string fragmentPath, const std::string geometryPath = "", Build build = Build::Immediate,
+           const std::vector<std::string>& defines = {});
+
+    /**
+     * @brief isReady - Завершена ли сборка программы. Не блокирует, если доступен GL_KHR_parallel_shader_compile,
+     * без расширения всегда возвращает true (статус можно узнать только с ожиданием).
+     */
+    bool isReady() const;
+
+    // Все ли программы пакета собраны (без ожидания)
+    static bool allReady(std::initializer_list<const Shader*> shaders);
 	
     // Активация шейдера
     void use() const;
@@ -62,6 +101,9 @@ public:
 
     unsigned int ID() const;
 
+    // Каталог кэша бинарных программ. Пустая строка отключает кэш
+    static void setBinaryCacheDirectory(const std::string& directory);
+
 private:
     std::string m_fileNameVertex;       // Имя файла с кодом вершинного шейдера
     std::string m_fileNameFragment;     // Имя файла с кодом фрагментного шейдера
@@ -71,6 +113,8 @@ private:
     std::string m_codeFragment;         // Код фрагментного шейдера
     std::string m_codeGeometry;         // Код геометрического шейдера
 
+    std::vector<std::string> m_defines; // Макросы варианта шейдера
+
     std::ifstream vShaderFile;          // Поток чтения файла с кодом вершинного шейдера
     std::ifstream fShaderFile;          //
     std::ifstream gShaderFile;          //
@@ -79,10 +123,17 @@ private:
     const std::string SHADER_TYPE_STRING_FRAGMENT = "FRAGMENT";
     const std::string SHADER_TYPE_STRING_GEOMETRY = "GEOMETRY";
 
-    unsigned int m_idGeometry;
-    unsigned int m_idVertex;
-    unsigned int m_idFragment;
-    unsigned int m_id = 0;
+    // Стадии живут от submitFromSource до finalize; если программу так и не использовали, их освобождают деструкторы
+    ShaderHandle m_idGeometry;
+    ShaderHandle m_idVertex;
+    ShaderHandle m_idFragment;
+    ProgramHandle m_id;
+
+    bool m_pending = false;             // Программа отправлена драйверу, но статус еще не проверен
+    bool m_fromBinary = false;          // Программа загружена из кэша бинарных программ
+
+    unsigned long long m_cacheKey = 0;  // Хэш исходников и драйвера, имя файла в кэше бинарных программ
 
+    static std::string s_binaryCacheDirectory;
 };
 #endif
@@ -1,20 +1,109 @@
 #version 330 core
+#ifdef GBUFFER
+layout (location = 0) out vec4 gAlbedo;     // rgb - альбедо, a - ID материала / 255
+layout (location = 1) out vec2 gNormal;     // Нормаль в октаэдрической упаковке
+#else
 out vec4 FragColor;
+#endif
 
 in vec2 TexCoords;
+#ifndef UNLIT
 in vec3 normal;
 in vec3 FragPos;
+#endif
+#ifdef HAS_NORMAL_MAP
+in mat3 TBN;
+#endif
 
 uniform sampler2D texture_diffuse1;
+#ifdef HAS_NORMAL_MAP
+uniform sampler2D texture_normal1;
+#endif
+#ifndef UNLIT
 uniform vec3 sourceLightPos;
+#endif
+
+#ifdef GBUFFER
+in vec3 WorldNormal;
+
+// ID материалов G-буфера (0 - пиксель без геометрии, проход освещения его пропускает)
+#define MATERIAL_LIT 1.0
+
+// Октаэдрическая упаковка единичного вектора в два числа [0, 1]
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+#endif
+
+#ifdef CLUSTERED
+in vec3 WorldNormal;
+in float ViewDepth;
+
+uniform usamplerBuffer clusterGrid;         // На кластер: смещение и число индексов
+uniform usamplerBuffer clusterLightIndices; // Индексы источников всех кластеров подряд
+uniform samplerBuffer clusterLights;        // На источник: (позиция, радиус), (цвет, яркость)
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileSize;               // Размер тайла в пикселях
+uniform vec2 clusterDepthParams;            // Срез = log(глубина) * x + y
+
+// Сумма вкладов точечных источников из кластера фрагмента
+vec3 clusteredLighting(vec3 albedo)
+{
+    ivec3 cell = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize), int(log(ViewDepth) * clusterDepthParams.x + clusterDepthParams.y));
+    cell = clamp(cell, ivec3(0), clusterDims - 1);
+    uvec2 range = texelFetch(clusterGrid, (cell.z * clusterDims.y + cell.y) * clusterDims.x + cell.x).xy;
+
+    vec3 n = normalize(WorldNormal);
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        vec4 positionRadius = texelFetch(clusterLights, light * 2);
+        vec4 colorIntensity = texelFetch(clusterLights, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float dist = length(toLight);
+        // Затухание плавно обращается в ноль на радиусе источника, поэтому кластеры за радиусом его не учитывают без разрыва
+        float falloff = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (dist * dist + 1.0);
+        float diff = max(dot(n, toLight / max(dist, 1e-4)), 0.0);
+        result += diff * attenuation * colorIntensity.rgb * colorIntensity.a;
+    }
+    return result * albedo;
+}
+#endif
 
 void main()
 {    
+#if defined(UNLIT)
+    FragColor = texture(texture_diffuse1, TexCoords);
+#elif defined(GBUFFER)
+#ifdef HAS_NORMAL_MAP
+    vec3 n = normalize(TBN * (texture(texture_normal1, TexCoords).rgb * 2.0 - 1.0));
+#else
+    vec3 n = normalize(WorldNormal);
+#endif
+    gAlbedo = vec4(texture(texture_diffuse1, TexCoords).rgb, MATERIAL_LIT / 255.0);
+    gNormal = octEncode(n);
+#else
+#ifdef HAS_NORMAL_MAP
+    vec3 norm = normalize(TBN * (texture(texture_normal1, TexCoords).rgb * 2.0 - 1.0));
+#else
 	vec3 norm = normalize(normal);
+#endif
     vec3 lightDir = normalize(sourceLightPos - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * vec3(1.0, 1.0, 1.0);
     FragColor = texture(texture_diffuse1, TexCoords);
     vec3 result = vec3(diffuse.x * FragColor.x, diffuse.y * FragColor.y, diffuse.z * FragColor.z);
+#ifdef CLUSTERED
+    result += clusteredLighting(FragColor.rgb);
+#endif
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+#endif
+}
@@ -2,19 +2,60 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef HAS_NORMAL_MAP
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in vec3 aBitangent;
+#endif
+#ifdef INSTANCED
+layout (location = 5) in mat4 aInstanceModel;
+#endif
 
 out vec2 TexCoords;
+#ifndef UNLIT
 out vec3 normal;
 out vec3 FragPos;
+#endif
+#ifdef HAS_NORMAL_MAP
+out mat3 TBN;
+#endif
+#if defined(CLUSTERED) || defined(GBUFFER)
+out vec3 WorldNormal;
+#endif
+#ifdef CLUSTERED
+out float ViewDepth;
+#endif
 
+#ifndef INSTANCED
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
-	FragPos = vec3(model * vec4(aPos, 1.0));
-    TexCoords = aTexCoords;    
+#ifdef INSTANCED
+    mat4 model = aInstanceModel;
+#endif
+    TexCoords = aTexCoords;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifndef UNLIT
+	FragPos = vec3(model * vec4(aPos, 1.0));
     normal = aNormal;
-}
\ No newline at end of file
+#endif
+#ifdef HAS_NORMAL_MAP
+    // Базис касательного пространства в том же пространстве, что и normal
+    TBN = mat3(normalize(aTangent), normalize(aBitangent), normalize(aNormal));
+#ifdef GBUFFER
+    // G-буфер хранит нормали в мировых координатах
+    TBN = mat3(model) * TBN;
+#endif
+#endif
+#if defined(CLUSTERED) || defined(GBUFFER)
+    // Точечные источники заданы в мировых координатах
+    WorldNormal = mat3(model) * aNormal;
+#endif
+#ifdef CLUSTERED
+    // Глубина в пространстве вида выбирает срез кластеров
+    ViewDepth = -(view * model * vec4(aPos, 1.0)).z;
+#endif
+}
@@ -0,0 +1,74 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D gAlbedo;                  // rgb - альбедо, a - ID материала / 255
+uniform sampler2D gNormal;                  // Нормаль в октаэдрической упаковке
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+uniform mat4 view;
+uniform vec3 sourceLightPos;                // Позиция звезды в мировых координатах
+
+// Кластерная сетка, общая с прямым вариантом CLUSTERED (см. 1.model_loading.fs)
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform samplerBuffer clusterLights;
+uniform ivec3 clusterDims;
+uniform vec2 clusterTileSize;
+uniform vec2 clusterDepthParams;
+
+vec3 octDecode(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 clusteredLighting(vec3 albedo, vec3 position, vec3 n, float viewDepth)
+{
+    ivec3 cell = ivec3(ivec2(gl_FragCoord.xy / clusterTileSize), int(log(viewDepth) * clusterDepthParams.x + clusterDepthParams.y));
+    cell = clamp(cell, ivec3(0), clusterDims - 1);
+    uvec2 range = texelFetch(clusterGrid, (cell.z * clusterDims.y + cell.y) * clusterDims.x + cell.x).xy;
+
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int light = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        vec4 positionRadius = texelFetch(clusterLights, light * 2);
+        vec4 colorIntensity = texelFetch(clusterLights, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - position;
+        float dist = length(toLight);
+        float falloff = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (dist * dist + 1.0);
+        float diff = max(dot(n, toLight / max(dist, 1e-4)), 0.0);
+        result += diff * attenuation * colorIntensity.rgb * colorIntensity.a;
+    }
+    return result * albedo;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    // ID 0 - в пикселе нет освещаемой геометрии
+    if (albedo.a < 0.5 / 255.0)
+        discard;
+
+    // Восстанавливаем мировую позицию по глубине
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gDepth, 0));
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec3 position = world.xyz / world.w;
+    vec3 n = octDecode(texelFetch(gNormal, pixel, 0).rg);
+
+    float diff = max(dot(n, normalize(sourceLightPos - position)), 0.0);
+    vec3 result = diff * albedo.rgb;
+    result += clusteredLighting(albedo.rgb, position, n, -(view * vec4(position, 1.0)).z);
+    FragColor = vec4(result, 1.0);
+
+    // Глубина G-буфера переносится в целевой буфер, чтобы следующие прямые проходы (небесная сфера) ее учитывали
+    gl_FragDepth = depth;
+}
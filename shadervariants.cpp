@@ -0,0 +1,108 @@
+#include "shadervariants.h"
+
+namespace
+{
+    // Имена макросов в порядке битов ShaderFeature
+    const char* const FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+        "HAS_NORMAL_MAP",
+        "UNLIT",
+        "INSTANCED",
+        "CLUSTERED",
+        "GBUFFER"
+    };
+}
+
+
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, std::initializer_list<unsigned int> preload)
+    : m_vertexPath(vertexPath),
+      m_fragmentPath(fragmentPath)
+{
+    for (unsigned int features : preload)
+        prepare(features);
+}
+
+
+
+Shader& ShaderVariants::get(unsigned int features)
+{
+    unsigned int key = normalize(features);
+    auto it = m_variants.find(key);
+    if (it != m_variants.end())
+        return *it->second;
+    return create(key, Shader::Build::Immediate);
+}
+
+
+
+void ShaderVariants::prepare(unsigned int features)
+{
+    unsigned int key = normalize(features);
+    if (m_variants.find(key) == m_variants.end())
+        create(key, Shader::Build::Deferred);
+}
+
+
+
+ImportProfile ShaderVariants::importProfile(unsigned int features)
+{
+    // Материал меша может добавить к базовым флагам HAS_NORMAL_MAP, поэтому модели нужно все, что читает любой из двух вариантов.
+    // Оба варианта отправляются драйверу до первого ожидания, чтобы собираться одновременно
+    prepare(features);
+    prepare(features | HAS_NORMAL_MAP);
+    ImportProfile profile = ImportProfile::fromProgram(get(features).ID());
+    profile |= ImportProfile::fromProgram(get(features | HAS_NORMAL_MAP).ID());
+    return profile;
+}
+
+
+
+bool ShaderVariants::importProfileReady(unsigned int features)
+{
+    prepare(features);
+    prepare(features | HAS_NORMAL_MAP);
+    return m_variants.at(normalize(features))->isReady() && m_variants.at(normalize(features | HAS_NORMAL_MAP))->isReady();
+}
+
+
+
+unsigned int ShaderVariants::normalize(unsigned int features)
+{
+    // Без освещения нормали и источники света не используются, и карта нормалей или кластеры только удлинили бы программу
+    if (features & UNLIT)
+        features &= ~static_cast<unsigned int>(HAS_NORMAL_MAP | CLUSTERED | GBUFFER);
+    // В G-буфер освещение не пишется: источники учитывает проход освещения
+    if (features & GBUFFER)
+        features &= ~static_cast<unsigned int>(CLUSTERED);
+    return features & ((1u << SHADER_FEATURE_COUNT) - 1);
+}
+
+
+
+std::vector<std::string> ShaderVariants::definesFor(unsigned int features)
+{
+    std::vector<std::string> defines;
+    for (unsigned int bit = 0; bit < SHADER_FEATURE_COUNT; bit++)
+    {
+        if (features & (1u << bit))
+            defines.push_back(FEATURE_DEFINES[bit]);
+    }
+    return defines;
+}
+
+
+
+size_t ShaderVariants::size() const
+{
+    return m_variants.size();
+}
+
+
+
+Shader& ShaderVariants::create(unsigned int key, Shader::Build build)
+{
+    std::unique_ptr<Shader> shader(new Shader(m_vertexPath, m_fragmentPath, "", build, definesFor(key)));
+    Shader& result = *shader;
+    m_variants[key] = std::move(shader);
+    return result;
+}
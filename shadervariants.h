@@ -0,0 +1,73 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "ShaderFeatures.hpp"
+#include "importprofile.h"
+#include "shader.h"
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ShaderVariants - Набор вариантов одной пары шейдеров, различающихся флагами ShaderFeature.
+ * Флаги вставляются в исходники как #define сразу после #version, вариант компилируется при первом запросе
+ * и кэшируется по ключу - нормализованной комбинации флагов. Так каждый материал получает минимальную
+ * программу без ветвлений uber-шейдера и без копий файлов шейдеров.
+ */
+class ShaderVariants
+{
+public:
+    /**
+     * @brief ShaderVariants - Набор вариантов пары шейдеров.
+     * @param preload - Варианты, которые сразу отправляются драйверу пакетом (см. prepare).
+     */
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, std::initializer_list<unsigned int> preload = {});
+
+    /**
+     * @brief get - Вариант для комбинации флагов. Компилируется при первом обращении.
+     * @param features - Флаги ShaderFeature.
+     */
+    Shader& get(unsigned int features);
+
+    /**
+     * @brief prepare - Заранее отправляем вариант драйверу (Shader::Build::Deferred), не дожидаясь компиляции.
+     */
+    void prepare(unsigned int features);
+
+    /**
+     * @brief importProfile - Что нужно загрузить модели, которую рисуют с базовыми флагами features.
+     * Собирает (при необходимости дожидается сборки) варианты, которые могут достаться ее мешам, и читает их активные
+     * атрибуты и сэмплеры.
+     */
+    ImportProfile importProfile(unsigned int features);
+
+    /**
+     * @brief importProfileReady - Соберет ли importProfile(features) профиль без ожидания компиляции. Не блокирует:
+     * недостающие варианты только отправляются драйверу (см. prepare).
+     */
+    bool importProfileReady(unsigned int features);
+
+    /**
+     * @brief normalize - Убираем флаги, которые не влияют на результат (например, карта нормалей без освещения).
+     */
+    static unsigned int normalize(unsigned int features);
+
+    // Имена макросов для комбинации флагов
+    static std::vector<std::string> definesFor(unsigned int features);
+
+    // Количество уже созданных вариантов
+    size_t size() const;
+
+private:
+    Shader& create(unsigned int key, Shader::Build build);
+
+private:
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::map<unsigned int, std::unique_ptr<Shader>> m_variants;
+};
+
+#endif // SHADER_VARIANTS_H
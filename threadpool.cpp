@@ -0,0 +1,128 @@
+#include "threadpool.h"
+#include "cpuprofiler.h"
+
+#include <algorithm>
+#include <string>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned int cores = std::thread::hardware_concurrency();
+        threadCount = cores > 1 ? cores - 1 : 0;
+    }
+
+    m_threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        m_threads.emplace_back([this, i]() {
+            PROFILE_THREAD_NAME(("Worker " + std::to_string(i)).c_str());
+            workerMain();
+        });
+    }
+}
+
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const RangeFunction& body)
+{
+    if (count == 0)
+        return;
+    grain = std::max<size_t>(grain, 1);
+
+    // Работы на одну порцию или нет рабочих потоков: будить никого не нужно
+    if (m_threads.empty() || count <= grain)
+    {
+        body(0, count);
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.count = count;
+    job.grain = grain;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(&job);
+    }
+    m_wake.notify_all();
+
+    runChunks(job);
+
+    // Все порции розданы. Убираем цикл из очереди, чтобы его не взял новый поток, и ждем тех, кто еще считает
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobs.erase(std::find(m_jobs.begin(), m_jobs.end(), &job));
+    m_done.wait(lock, [&job]() { return job.helpers == 0; });
+}
+
+
+
+unsigned int ThreadPool::concurrency() const
+{
+    return static_cast<unsigned int>(m_threads.size()) + 1;
+}
+
+
+
+void ThreadPool::workerMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        Job* job = nullptr;
+        m_wake.wait(lock, [this, &job]() {
+            job = pickJob();
+            return m_stop || job != nullptr;
+        });
+        if (m_stop)
+            return;
+
+        job->helpers++;
+        lock.unlock();
+        runChunks(*job);
+        lock.lock();
+        if (--job->helpers == 0)
+            m_done.notify_all();
+    }
+}
+
+
+
+ThreadPool::Job* ThreadPool::pickJob() const
+{
+    Job* best = nullptr;
+    for (Job* job : m_jobs)
+    {
+        if (job->next.load(std::memory_order_relaxed) >= job->count)
+            continue;
+        if (best == nullptr || job->helpers < best->helpers)
+            best = job;
+    }
+    return best;
+}
+
+
+
+void ThreadPool::runChunks(Job& job)
+{
+    for (;;)
+    {
+        size_t begin = job.next.fetch_add(job.grain, std::memory_order_relaxed);
+        if (begin >= job.count)
+            return;
+        (*job.body)(begin, std::min(begin + job.grain, job.count));
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ThreadPool - Постоянные рабочие потоки для параллельных циклов по данным.
+ * Потоки создаются один раз и спят между вызовами parallelFor, поэтому цикл можно запускать каждый кадр.
+ * В программе один пул на всех (его создает main и передает потокам обновления, рендеринга и загрузки моделей):
+ * несколько пулов по числу ядер каждый перегружали бы процессор в несколько раз.
+ */
+class ThreadPool
+{
+public:
+    // Диапазон [begin, end) индексов, обрабатываемый одним вызовом тела цикла
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    /**
+     * @brief ThreadPool - Создаем рабочие потоки.
+     * @param threadCount - Количество рабочих потоков; 0 - по числу ядер минус вызывающий поток.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief parallelFor - Выполняем body для индексов [0, count), разбитых на порции по grain.
+     * Вызывающий поток участвует в работе; возврат - после обработки всех порций. Циклы разных потоков идут
+     * одновременно: каждый вызывающий поток разбирает свои порции, а рабочие потоки распределяются между всеми
+     * незаконченными циклами поровну, поэтому ни один цикл не остается без помощи пула.
+     * Вызовы нельзя вкладывать: body не должен вызывать parallelFor того же пула.
+     */
+    void parallelFor(size_t count, size_t grain, const RangeFunction& body);
+
+    // Количество потоков, выполняющих parallelFor (рабочие + вызывающий)
+    unsigned int concurrency() const;
+
+private:
+    // Цикл одного вызова parallelFor. Живет на стеке вызывающего потока, пока к нему не обращается ни один рабочий поток
+    struct Job
+    {
+        const RangeFunction*    body;
+        size_t                  count;
+        size_t                  grain;
+        std::atomic<size_t>     next{0};        // Первый индекс следующей свободной порции
+        unsigned int            helpers = 0;    // Рабочие потоки, разбирающие порции цикла (под m_mutex)
+    };
+
+    void workerMain();
+    // Незаконченный цикл с наименьшим числом помощников или nullptr. Вызывается под m_mutex
+    Job* pickJob() const;
+    static void runChunks(Job& job);
+
+private:
+    std::vector<std::thread>    m_threads;
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_wake;         // Новая работа или остановка
+    std::condition_variable     m_done;         // Рабочий поток отпустил цикл
+
+    std::vector<Job*>           m_jobs;         // Циклы, идущие сейчас (под m_mutex)
+    bool                        m_stop = false;
+};
+
+#endif // THREAD_POOL_H
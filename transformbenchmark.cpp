@@ -0,0 +1,99 @@
+#include "transformbenchmark.h"
+#include "benchmark.h"
+#include "transformsystem.h"
+#include "threadpool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    const int PASSES = 25;
+
+    float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+    {
+        float difference = 0.0f;
+        for (size_t i = 0; i < a.size(); i++)
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 4; r++)
+                    difference = std::max(difference, std::abs(a[i][c][r] - b[i][c][r]));
+        return difference;
+    }
+}
+
+
+
+int runTransformBenchmark(size_t count)
+{
+    // Повторяемая сцена: объекты в кубе 200^3 со случайной ориентацией и масштабом 0.5..2
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scaleFactor(0.5f, 2.0f);
+
+    std::vector<glm::vec3> positions(count);
+    std::vector<glm::quat> rotations(count);
+    std::vector<glm::vec3> scales(count);
+    TransformSystem transforms;
+    transforms.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        positions[i] = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        rotations[i] = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+        scales[i] = glm::vec3(scaleFactor(random), scaleFactor(random), scaleFactor(random));
+        transforms.create(positions[i], rotations[i], scales[i]);
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 50.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<glm::mat4> world(count);
+    std::vector<glm::mat4> modelView(count);
+    auto glmWorld = [&]() {
+        for (size_t i = 0; i < count; i++)
+            world[i] = glm::scale(glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]), scales[i]);
+    };
+    auto glmModelView = [&]() {
+        for (size_t i = 0; i < count; i++)
+        {
+            world[i] = glm::scale(glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]), scales[i]);
+            modelView[i] = view * world[i];
+        }
+    };
+
+    ThreadPool workers;
+
+    std::cout << "Transform benchmark: " << count << " objects, median of " << PASSES << " passes, "
+              << workers.concurrency() << " threads"
+#ifdef ONION_SIMD_SSE
+              << ", SSE"
+#endif
+              << std::endl;
+    std::cout << std::left << std::setw(16) << "path" << std::right << std::setw(12) << "world ms" << std::setw(16) << "world+view ms" << std::endl;
+
+    auto report = [](const char* name, double worldMs, double modelViewMs) {
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << worldMs << std::setw(16) << modelViewMs << std::endl;
+    };
+
+    double glmWorldMs = Benchmark::measure(glmWorld, PASSES);
+    double glmModelViewMs = Benchmark::measure(glmModelView, PASSES);
+    report("glm scalar", glmWorldMs, glmModelViewMs);
+
+    report("soa 1 thread",
+           Benchmark::measure([&]() { transforms.compose(); }, PASSES),
+           Benchmark::measure([&]() { transforms.composeModelView(view); }, PASSES));
+    report("soa pool",
+           Benchmark::measure([&]() { transforms.compose(&workers); }, PASSES),
+           Benchmark::measure([&]() { transforms.composeModelView(view, &workers); }, PASSES));
+
+    std::cout << std::scientific << std::setprecision(2)
+              << "max difference vs glm: world " << maxDifference(world, transforms.worldMatrices())
+              << ", model-view " << maxDifference(modelView, transforms.modelViewMatrices()) << std::endl;
+    return 0;
+}
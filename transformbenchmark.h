@@ -0,0 +1,15 @@
+#ifndef TRANSFORM_BENCHMARK_H
+#define TRANSFORM_BENCHMARK_H
+
+#include <cstddef>
+
+/**
+ * @brief runTransformBenchmark - Микробенчмарк сборки матриц: для count объектов со случайными позицией,
+ * поворотом и масштабом сравниваем покомпонентный путь glm (translate * mat4_cast * scale, затем view * M)
+ * с TransformSystem в одном потоке и на ThreadPool. Печатаем медиану времени прохода и расхождение с glm.
+ * GL-контекст не нужен.
+ * @return - Код возврата процесса (0 при успехе).
+ */
+int runTransformBenchmark(size_t count);
+
+#endif // TRANSFORM_BENCHMARK_H
@@ -0,0 +1,212 @@
+#include "transformsystem.h"
+#include "cpuprofiler.h"
+#include "Simd.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+void TransformSystem::reserve(size_t count)
+{
+    for (std::vector<float>* component : { &m_positionX, &m_positionY, &m_positionZ,
+                                           &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW,
+                                           &m_scaleX, &m_scaleY, &m_scaleZ })
+        component->reserve(count);
+    m_world.reserve(count);
+}
+
+
+
+TransformSystem::Handle TransformSystem::create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    Handle handle = static_cast<Handle>(size());
+    m_positionX.push_back(position.x);
+    m_positionY.push_back(position.y);
+    m_positionZ.push_back(position.z);
+    m_rotationX.push_back(rotation.x);
+    m_rotationY.push_back(rotation.y);
+    m_rotationZ.push_back(rotation.z);
+    m_rotationW.push_back(rotation.w);
+    m_scaleX.push_back(scale.x);
+    m_scaleY.push_back(scale.y);
+    m_scaleZ.push_back(scale.z);
+    m_world.emplace_back(1.0f);
+    return handle;
+}
+
+
+
+void TransformSystem::setPosition(Handle handle, const glm::vec3& position)
+{
+    m_positionX[handle] = position.x;
+    m_positionY[handle] = position.y;
+    m_positionZ[handle] = position.z;
+}
+
+
+
+void TransformSystem::setRotation(Handle handle, const glm::quat& rotation)
+{
+    m_rotationX[handle] = rotation.x;
+    m_rotationY[handle] = rotation.y;
+    m_rotationZ[handle] = rotation.z;
+    m_rotationW[handle] = rotation.w;
+}
+
+
+
+void TransformSystem::setScale(Handle handle, const glm::vec3& scale)
+{
+    m_scaleX[handle] = scale.x;
+    m_scaleY[handle] = scale.y;
+    m_scaleZ[handle] = scale.z;
+}
+
+
+
+void TransformSystem::setPositions(Handle first, size_t count, const float* x, const float* y, const float* z)
+{
+    std::copy(x, x + count, m_positionX.begin() + first);
+    std::copy(y, y + count, m_positionY.begin() + first);
+    std::copy(z, z + count, m_positionZ.begin() + first);
+}
+
+
+
+void TransformSystem::compose(ThreadPool* workers)
+{
+    run(nullptr, workers);
+}
+
+
+
+void TransformSystem::composeModelView(const glm::mat4& view, ThreadPool* workers)
+{
+    m_modelView.resize(size());
+    run(&view, workers);
+}
+
+
+
+void TransformSystem::run(const glm::mat4* view, ThreadPool* workers)
+{
+    PROFILE_ZONE("TransformSystem::compose");
+
+    if (workers == nullptr)
+    {
+        composeRange(0, size(), view);
+        return;
+    }
+    // Порции кратны четырем, поэтому каждая, кроме последней, целиком проходит пакетами
+    workers->parallelFor(size(), PARALLEL_GRAIN, [this, view](size_t begin, size_t end) {
+        composeRange(begin, end, view);
+    });
+}
+
+
+
+void TransformSystem::composeRange(size_t begin, size_t end, const glm::mat4* view)
+{
+    size_t i = begin;
+
+#ifdef ONION_SIMD_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 viewColumns[4];
+    if (view != nullptr)
+        for (int c = 0; c < 4; c++)
+            viewColumns[c] = _mm_loadu_ps(glm::value_ptr(*view) + c * 4);
+
+    for (; i + 4 <= end; i += 4)
+    {
+        // Поворот из кватерниона для четырех объектов: каждый регистр - один элемент матрицы в четырех объектах
+        __m128 x = _mm_loadu_ps(&m_rotationX[i]);
+        __m128 y = _mm_loadu_ps(&m_rotationY[i]);
+        __m128 z = _mm_loadu_ps(&m_rotationZ[i]);
+        __m128 w = _mm_loadu_ps(&m_rotationW[i]);
+
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        __m128 sx = _mm_loadu_ps(&m_scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&m_scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&m_scaleZ[i]);
+
+        // Столбцы M = T * R * S: столбцы поворота, умноженные на масштаб по своей оси, и перенос
+        __m128 columns[4][4] = {
+            {
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+                zero
+            },
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+                zero
+            },
+            {
+                _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+                zero
+            },
+            {
+                _mm_loadu_ps(&m_positionX[i]),
+                _mm_loadu_ps(&m_positionY[i]),
+                _mm_loadu_ps(&m_positionZ[i]),
+                one
+            }
+        };
+
+        // После транспонирования columns[c][k] - столбец c матрицы объекта i + k
+        for (int c = 0; c < 4; c++)
+        {
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+            for (int k = 0; k < 4; k++)
+                _mm_storeu_ps(glm::value_ptr(m_world[i + k]) + c * 4, columns[c][k]);
+        }
+
+        if (view == nullptr)
+            continue;
+
+        for (int k = 0; k < 4; k++)
+        {
+            float* modelView = glm::value_ptr(m_modelView[i + k]);
+            for (int c = 0; c < 4; c++)
+            {
+                const __m128 column = columns[c][k];
+                __m128 result = _mm_mul_ps(viewColumns[0], _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+                result = _mm_add_ps(result, _mm_mul_ps(viewColumns[1], _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+                result = _mm_add_ps(result, _mm_mul_ps(viewColumns[2], _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+                result = _mm_add_ps(result, _mm_mul_ps(viewColumns[3], _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+                _mm_storeu_ps(modelView + c * 4, result);
+            }
+        }
+    }
+#endif
+
+    for (; i < end; i++)
+        composeOne(i, view);
+}
+
+
+
+void TransformSystem::composeOne(size_t i, const glm::mat4* view)
+{
+    float x = m_rotationX[i], y = m_rotationY[i], z = m_rotationZ[i], w = m_rotationW[i];
+    float sx = m_scaleX[i], sy = m_scaleY[i], sz = m_scaleZ[i];
+
+    glm::mat4& world = m_world[i];
+    world[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f);
+    world[1] = glm::vec4(2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f);
+    world[2] = glm::vec4(2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+    world[3] = glm::vec4(m_positionX[i], m_positionY[i], m_positionZ[i], 1.0f);
+
+    if (view != nullptr)
+        m_modelView[i] = *view * world;
+}
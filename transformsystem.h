@@ -0,0 +1,70 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "threadpool.h"
+
+/**
+ * @brief TransformSystem - Трансформации объектов в виде структуры массивов: позиция, кватернион поворота
+ * и масштаб хранятся покомпонентно, поэтому матрицы M = T * R * S собираются по четыре объекта за раз
+ * (SSE, на остальных платформах - скалярно с тем же результатом). При большом числе объектов работа
+ * делится между потоками ThreadPool.
+ * Кватернионы должны быть нормированы.
+ */
+class TransformSystem
+{
+public:
+    using Handle = std::uint32_t;
+
+    // Меньше объектов на порцию не раздаем рабочим потокам: пробуждение дороже самой работы
+    static const size_t PARALLEL_GRAIN = 4096;
+
+    void reserve(size_t count);
+    Handle create(const glm::vec3& position = glm::vec3(0.0f),
+                  const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                  const glm::vec3& scale = glm::vec3(1.0f));
+    size_t size() const { return m_positionX.size(); }
+
+    void setPosition(Handle handle, const glm::vec3& position);
+    void setRotation(Handle handle, const glm::quat& rotation);
+    void setScale(Handle handle, const glm::vec3& scale);
+
+    // Позиции count объектов начиная с first из покомпонентных массивов
+    void setPositions(Handle first, size_t count, const float* x, const float* y, const float* z);
+
+    /**
+     * @brief compose - Собираем мировые матрицы всех объектов.
+     * @param workers - Потоки для деления работы (nullptr - в вызывающем потоке).
+     */
+    void compose(ThreadPool* workers = nullptr);
+
+    /**
+     * @brief composeModelView - Собираем за один проход мировые матрицы и матрицы модели-вида view * M.
+     */
+    void composeModelView(const glm::mat4& view, ThreadPool* workers = nullptr);
+
+    const glm::mat4& world(Handle handle) const { return m_world[handle]; }
+    const glm::mat4& modelView(Handle handle) const { return m_modelView[handle]; }
+    const std::vector<glm::mat4>& worldMatrices() const { return m_world; }
+    const std::vector<glm::mat4>& modelViewMatrices() const { return m_modelView; }
+
+private:
+    void run(const glm::mat4* view, ThreadPool* workers);
+    void composeRange(size_t begin, size_t end, const glm::mat4* view);
+    void composeOne(size_t i, const glm::mat4* view);
+
+private:
+    std::vector<float>      m_positionX, m_positionY, m_positionZ;
+    std::vector<float>      m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+    std::vector<float>      m_scaleX, m_scaleY, m_scaleZ;
+
+    std::vector<glm::mat4>  m_world;
+    std::vector<glm::mat4>  m_modelView;
+};
+
+#endif // TRANSFORM_SYSTEM_H